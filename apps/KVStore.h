@@ -1,32 +1,113 @@
 #ifndef L5RDMA_KVSTORE_H
 #define L5RDMA_KVSTORE_H
 
-#include <unordered_map>
 #include <cstring>
-#include "transports/Transport.h"
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "datastructures/FlatHashTable.h"
+#include "include/Transport.h"
 
-struct KvInput {
-    char command[8]; // 7 chars + \0
-    size_t key;
-    size_t value;
+/**
+ * Binary KV protocol. Every request starts with a KvHeader, followed by count keys (GET, DELETE, MULTI_GET) or count
+ * key value pairs (PUT, MULTI_PUT), all uint64_t. GET, PUT and DELETE are meant for a count of 1.
+ * Every request is answered with count uint64_t in a single message: the value of each key before the request was
+ * executed, or kvNotFound.
+ */
+enum class KvOpcode : uint8_t {
+    GET = 1,
+    PUT = 2,
+    DELETE = 3,
+    MULTI_GET = 4,
+    MULTI_PUT = 5,
 };
 
+struct KvHeader {
+    KvOpcode opcode;
+    uint8_t reserved[3];
+    uint32_t count;
+};
+
+static constexpr uint64_t kvNotFound = std::numeric_limits<uint64_t>::max();
+/// Upper bound for count, so the server can use fixed size buffers
+static constexpr uint32_t kvMaxCount = 1024;
+
+/// Size of one key / key value pair following the header
+inline size_t kvStride(KvOpcode opcode) {
+    switch (opcode) {
+        case KvOpcode::GET:
+        case KvOpcode::DELETE:
+        case KvOpcode::MULTI_GET:
+            return sizeof(uint64_t);
+        case KvOpcode::PUT:
+        case KvOpcode::MULTI_PUT:
+            return 2 * sizeof(uint64_t);
+    }
+    throw std::runtime_error{"unknown opcode from client"};
+}
+
+/// Size of the keys / key value pairs following the header
+inline size_t kvPayloadSize(const KvHeader &header) {
+    return header.count * kvStride(header.opcode);
+}
+
+/// Execute the request on table and write the response values. Returns the size of the response in bytes
+template<typename Table>
+size_t kvExecute(Table &table, const KvHeader &header, const uint8_t *payload, uint8_t *response) {
+    if (header.count > kvMaxCount) {
+        throw std::runtime_error{"request exceeds kvMaxCount"};
+    }
+    const auto stride = kvStride(header.opcode);
+    for (size_t i = 0; i < header.count; ++i) {
+        uint64_t key;
+        std::memcpy(&key, payload + i * stride, sizeof(key));
+        const auto old = table.find(key);
+        const uint64_t result = old != nullptr ? *old : kvNotFound;
+        switch (header.opcode) {
+            case KvOpcode::GET:
+            case KvOpcode::MULTI_GET:
+                break;
+            case KvOpcode::PUT:
+            case KvOpcode::MULTI_PUT: {
+                uint64_t value;
+                std::memcpy(&value, payload + i * stride + sizeof(key), sizeof(value));
+                table.insert(key, value);
+                break;
+            }
+            case KvOpcode::DELETE:
+                table.erase(key);
+                break;
+        }
+        std::memcpy(response + i * sizeof(uint64_t), &result, sizeof(result));
+    }
+    return header.count * sizeof(uint64_t);
+}
+
+/**
+ * KV server on a single connection. Reads the header and the payload of a request separately, so clients need to
+ * write them as two messages on message based transports (see KVClient)
+ */
 template<typename T>
 struct KVStore {
-    std::unique_ptr<TransportServer<T>> transport;
-    std::unordered_map<uint64_t, uint64_t> store;
+    std::unique_ptr<l5::transport::TransportServer<T>> transport;
+    l5::datastructure::FlatHashTable<uint64_t, uint64_t> store;
+    std::vector<uint8_t> payload = std::vector<uint8_t>(kvMaxCount * 2 * sizeof(uint64_t));
+    std::vector<uint8_t> response = std::vector<uint8_t>(kvMaxCount * sizeof(uint64_t));
 
-    explicit KVStore(std::unique_ptr<TransportServer<T>> t) : transport(std::move(t)) {}
+    explicit KVStore(std::unique_ptr<l5::transport::TransportServer<T>> t) : transport(std::move(t)) {}
 
     std::optional<uint64_t> get(uint64_t k) {
         auto res = store.find(k);
-        if (res != store.end()) {
-            return res->second;
+        if (res != nullptr) {
+            return *res;
         }
         return std::nullopt;
     }
 
-    void insert(uint64_t k, uint64_t v) { store[k] = v; }
+    void insert(uint64_t k, uint64_t v) { store.insert(k, v); }
 
     void deleteKey(uint64_t k) { store.erase(k); }
 
@@ -35,42 +116,65 @@ struct KVStore {
     }
 
     void respond() {
-        static constexpr auto get = "SELECT ";
-        static constexpr auto ins = "INSERT ";
-        static constexpr auto del = "DELETE ";
-
-        static_assert(strlen(get) == strlen(ins));
-        static_assert(strlen(get) == strlen(del));
-        static_assert(strlen(get) == 7);
-
-        KvInput input{};
-
-        transport->read(reinterpret_cast<uint8_t *>(&input), sizeof(input));
-
-        const auto key = &input.key;
-        const auto val = &input.value;
-        std::optional < size_t > res;
-
-        switch (input.command[0]) {
-            case 'S':
-                res = this->get(*key);
-                size_t output;
-                if (res.has_value()) {
-                    output = res.value();
-                } else {
-                    output = std::numeric_limits<size_t>::max();
-                }
-                transport->write(reinterpret_cast<uint8_t *>(&output), sizeof(output));
-                break;
-            case 'I':
-                insert(*key, *val);
-                break;
-            case 'D':
-                deleteKey(*key);
-                break;
-            default:
-                throw std::runtime_error{"unknown command from client"};
+        KvHeader header{};
+        transport->read(header);
+        if (header.count > kvMaxCount) {
+            throw std::runtime_error{"request exceeds kvMaxCount"};
+        }
+        transport->read(payload.data(), kvPayloadSize(header));
+
+        const auto size = kvExecute(store, header, payload.data(), response.data());
+        transport->write(response.data(), size);
+    }
+};
+
+/// Client for KVStore
+template<typename T>
+struct KVClient {
+    std::unique_ptr<l5::transport::TransportClient<T>> transport;
+
+    KVClient(std::unique_ptr<l5::transport::TransportClient<T>> t, const std::string &whereTo)
+            : transport(std::move(t)) {
+        transport->connect(whereTo);
+    }
+
+    /// Lookup all keys with one request. values needs to have room for keys.size() entries
+    void multiGet(const std::vector<uint64_t> &keys, uint64_t *values) {
+        request(KvOpcode::MULTI_GET, keys.data(), keys.size(), values);
+    }
+
+    /// Store all (key, value) pairs with one request
+    void multiPut(const std::vector<std::pair<uint64_t, uint64_t>> &pairs) {
+        std::vector<uint64_t> old(pairs.size());
+        request(KvOpcode::MULTI_PUT, pairs.data(), pairs.size(), old.data());
+    }
+
+    uint64_t get(uint64_t key) {
+        uint64_t value;
+        request(KvOpcode::GET, &key, 1, &value);
+        return value;
+    }
+
+    void put(uint64_t key, uint64_t value) {
+        const uint64_t pair[] = {key, value};
+        uint64_t old;
+        request(KvOpcode::PUT, pair, 1, &old);
+    }
+
+    void deleteKey(uint64_t key) {
+        uint64_t old;
+        request(KvOpcode::DELETE, &key, 1, &old);
+    }
+
+private:
+    void request(KvOpcode opcode, const void *payload, size_t count, uint64_t *values) {
+        if (count > kvMaxCount) {
+            throw std::runtime_error{"request exceeds kvMaxCount"};
         }
+        const auto header = KvHeader{opcode, {}, static_cast<uint32_t>(count)};
+        transport->write(header);
+        transport->write(reinterpret_cast<const uint8_t *>(payload), kvPayloadSize(header));
+        transport->read(reinterpret_cast<uint8_t *>(values), count * sizeof(uint64_t));
     }
 };
 
@@ -0,0 +1,154 @@
+#ifndef L5RDMA_RPC_H
+#define L5RDMA_RPC_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "include/Transport.h"
+
+/// Prefixes every request and response. The payload follows as a separate message of exactly size bytes
+struct RpcHeader {
+    uint32_t id;
+    uint32_t size;
+};
+
+/**
+ * Client side of a small RPC layer on top of the (ring buffer) transports.
+ * Unlike Ping, the client doesn't wait for each response: up to `window` requests can be outstanding, so latency bound
+ * clients keep the pipe full. Responses may arrive in any order, they're matched by their request id and handed to the
+ * callback given with the request.
+ */
+template<class T>
+class RpcClient {
+public:
+    using Callback = std::function<void(const uint8_t *data, size_t size)>;
+
+private:
+    std::unique_ptr<l5::transport::TransportClient<T>> transport;
+    /// callback per request id, the ids of outstanding requests are [0, window)
+    std::vector<Callback> callbacks;
+    std::vector<uint32_t> freeIds;
+    std::vector<uint8_t> responseBuffer;
+
+public:
+    RpcClient(std::unique_ptr<l5::transport::TransportClient<T>> t, const std::string &whereTo, size_t window,
+              size_t maxResponseSize = 64)
+            : transport(std::move(t)),
+              callbacks(window),
+              responseBuffer(maxResponseSize) {
+        for (auto id = static_cast<uint32_t>(window); id > 0; --id) {
+            freeIds.push_back(id - 1);
+        }
+        for (int i = 0;; ++i) {
+            try {
+                transport->connect(whereTo);
+                break;
+            } catch (...) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                if (i > 10) throw;
+            }
+        }
+    }
+
+    /// Send a request and call callback with the response, once it arrives. Blocks only while the window is full
+    template<typename Fun>
+    void call(const uint8_t *data, size_t size, Fun &&callback) {
+        while (freeIds.empty()) {
+            complete();
+        }
+        const auto id = freeIds.back();
+        freeIds.pop_back();
+        callbacks[id] = std::forward<Fun>(callback);
+
+        transport->write(RpcHeader{id, static_cast<uint32_t>(size)});
+        transport->write(data, size);
+    }
+
+    /// Blocking wait for the next response and dispatch it to its callback
+    void complete() {
+        if (outstanding() == 0) {
+            throw std::runtime_error{"no outstanding requests"};
+        }
+        RpcHeader header{};
+        transport->read(header);
+        if (header.id >= callbacks.size() || header.size > responseBuffer.size()) {
+            throw std::runtime_error{"received unexpected response"};
+        }
+        transport->read(responseBuffer.data(), header.size);
+
+        auto callback = std::move(callbacks[header.id]);
+        freeIds.push_back(header.id); // free before calling back, so the callback can issue new requests
+        callback(responseBuffer.data(), header.size);
+    }
+
+    /// Wait for all outstanding responses
+    void drain() {
+        while (outstanding() > 0) {
+            complete();
+        }
+    }
+
+    size_t outstanding() const { return callbacks.size() - freeIds.size(); }
+};
+
+/**
+ * Server side of the RPC layer. Either serve() requests in order, or receive() and respond() individually, to complete
+ * requests out of order. Responses written by serve()'s handler must fit into maxResponseSize, which is passed to it
+ */
+template<class T>
+class RpcServer {
+    std::unique_ptr<l5::transport::TransportServer<T>> transport;
+    std::vector<uint8_t> requestBuffer;
+    std::vector<uint8_t> responseBuffer;
+
+public:
+    explicit RpcServer(std::unique_ptr<l5::transport::TransportServer<T>> t, size_t maxRequestSize = 64,
+                       size_t maxResponseSize = 64)
+            : transport(std::move(t)),
+              requestBuffer(maxRequestSize),
+              responseBuffer(maxResponseSize) {}
+
+    void start() {
+        transport->accept();
+    }
+
+    /// Blocking receive of the next request. The payload stays valid until the next call to receive()
+    RpcHeader receive() {
+        RpcHeader header{};
+        transport->read(header);
+        if (header.size > requestBuffer.size()) {
+            throw std::runtime_error{"request exceeds maxRequestSize"};
+        }
+        transport->read(requestBuffer.data(), header.size);
+        return header;
+    }
+
+    const uint8_t *payload() const { return requestBuffer.data(); }
+
+    void respond(uint32_t id, const uint8_t *data, size_t size) {
+        transport->write(RpcHeader{id, static_cast<uint32_t>(size)});
+        transport->write(data, size);
+    }
+
+    /**
+     * Receive one request and immediately respond to it
+     * @param handler size_t(const uint8_t *request, size_t requestSize, uint8_t *response, size_t responseCapacity),
+     * returning the response size, at most responseCapacity
+     */
+    template<typename Handler>
+    void serve(Handler &&handler) {
+        const auto header = receive();
+        const auto size = handler(requestBuffer.data(), static_cast<size_t>(header.size), responseBuffer.data(),
+                                  responseBuffer.size());
+        if (size > responseBuffer.size()) {
+            throw std::runtime_error{"response exceeds maxResponseSize"};
+        }
+        respond(header.id, responseBuffer.data(), size);
+    }
+};
+
+#endif //L5RDMA_RPC_H
@@ -0,0 +1,148 @@
+#ifndef L5RDMA_SHARDEDKVSTORE_H
+#define L5RDMA_SHARDEDKVSTORE_H
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "apps/KVStore.h"
+#include "datastructures/FlatHashTable.h"
+#include "include/MulticlientRDMATransport.h"
+#include "util/Affinity.h"
+
+/**
+ * KV engine, partitioned into one shard per core. Each shard owns its hash table exclusively and serves its clients
+ * via a multi-client RDMA transport on basePort + shard, so there is no synchronization between the shards.
+ * Clients route each request to shardOf(key), all keys of a MULTI_GET / MULTI_PUT need to belong to the same shard.
+ * A request is a single message: the KvHeader directly followed by its payload (see KVStore.h).
+ * A shard collects up to BATCH_SIZE requests of different clients, then prefetches all their hash table slots before
+ * executing and answering them.
+ */
+class ShardedKVStore {
+public:
+    using Table = l5::datastructure::FlatHashTable<uint64_t, uint64_t>;
+    static constexpr size_t BATCH_SIZE = 16;
+
+    /// Shard responsible for key. Uses the high bits of the hash, while the hash tables use the low bits
+    static size_t shardOf(uint64_t key, size_t shards) {
+        return ((Table::hash(key) >> 32) * shards) >> 32;
+    }
+
+private:
+    struct alignas(64) Shard {
+        Table table;
+        l5::transport::MulticlientRDMATransportServer transport;
+        std::atomic<size_t> processed{0};
+
+        Shard(const std::string &port, size_t maxClients) : transport(port, maxClients) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopped{false};
+
+    void serve(Shard &shard) {
+        /// points into the receive buffer of sender, which stays untouched until we answered
+        struct Request {
+            size_t sender;
+            KvHeader header;
+            const uint8_t *payload;
+        };
+        std::array<Request, BATCH_SIZE> batch{};
+
+        while (not stopped.load(std::memory_order_relaxed)) {
+            size_t count = 0;
+            while (count < BATCH_SIZE &&
+                   shard.transport.tryReceive([&](size_t sender, const uint8_t *begin, const uint8_t *end) {
+                       auto &request = batch[count];
+                       std::memcpy(&request.header, begin, sizeof(KvHeader));
+                       request.sender = sender;
+                       request.payload = begin + sizeof(KvHeader);
+                       if (static_cast<size_t>(end - request.payload) != kvPayloadSize(request.header)) {
+                           throw std::runtime_error{"unexpected request size"};
+                       }
+                       ++count;
+                   })) {}
+
+            // hide the cache misses of the whole batch, before touching the table
+            for (size_t i = 0; i < count; ++i) {
+                const auto stride = kvStride(batch[i].header.opcode);
+                for (size_t k = 0; k < batch[i].header.count; ++k) {
+                    uint64_t key;
+                    std::memcpy(&key, batch[i].payload + k * stride, sizeof(key));
+                    shard.table.prefetch(key);
+                }
+            }
+            for (size_t i = 0; i < count; ++i) {
+                // pack all values of the response into one message
+                shard.transport.send(batch[i].sender, [&](uint8_t *response) {
+                    return kvExecute(shard.table, batch[i].header, batch[i].payload, response);
+                });
+            }
+            shard.processed.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    /**
+     * @param basePort shard i listens on basePort + i
+     * @param shardCount number of shards, usually the number of cores
+     * @param maxClientsPerShard needs to be a multiple of 16
+     */
+    ShardedKVStore(uint16_t basePort, size_t shardCount, size_t maxClientsPerShard = 16) {
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards.push_back(std::make_unique<Shard>(std::to_string(basePort + i), maxClientsPerShard));
+        }
+    }
+
+    ~ShardedKVStore() {
+        stop();
+    }
+
+    /// Load data, only allowed before start()
+    void insert(uint64_t key, uint64_t value) {
+        shards[shardOf(key, shards.size())]->table.insert(key, value);
+    }
+
+    /// Start one thread per shard, that accepts clientsPerShard connections and then serves them. By default, each
+    /// thread is pinned to its own core (see util/Affinity.h, the topology can be overridden with L5RDMA_TOPOLOGY)
+    void start(size_t clientsPerShard, l5::util::Spread spread = l5::util::Spread::Cores) {
+        stopped = false;
+        const auto topology = l5::util::Topology::fromEnvironment();
+        for (size_t i = 0; i < shards.size(); ++i) {
+            threads.emplace_back([this, i, clientsPerShard, topology, spread] {
+                topology.pin(i, spread);
+                auto &shard = *shards[i];
+                for (size_t c = 0; c < clientsPerShard; ++c) {
+                    shard.transport.accept();
+                }
+                serve(shard);
+            });
+        }
+    }
+
+    void stop() {
+        stopped = true;
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        threads.clear();
+    }
+
+    /// Number of requests (not keys) processed by all shards so far
+    size_t processed() const {
+        size_t sum = 0;
+        for (const auto &shard : shards) {
+            sum += shard->processed.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    size_t shardCount() const { return shards.size(); }
+};
+
+#endif //L5RDMA_SHARDEDKVSTORE_H
@@ -0,0 +1,152 @@
+#ifndef L5RDMA_FLATHASHTABLE_H
+#define L5RDMA_FLATHASHTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace l5 {
+namespace datastructure {
+/**
+ * Open addressing hash table with linear probing for integral keys.
+ * Keys and values are stored inline in one flat array, so a lookup usually touches a single cache line, instead of
+ * chasing the node pointers of a std::unordered_map. Erasing uses backward shift deletion, so there are no tombstones.
+ * Not thread safe, intended to be partitioned per core.
+ */
+template<typename Key, typename Value>
+class FlatHashTable {
+   static_assert(std::is_integral<Key>::value, "");
+
+   /// Marks empty slots. The key itself is stored outside of the slots
+   static constexpr Key emptyKey = std::numeric_limits<Key>::max();
+   static constexpr double maxLoadFactor = 0.75;
+
+   struct Slot {
+      Key key;
+      Value value;
+   };
+
+   std::vector<Slot> slots;
+   size_t mask;
+   size_t count = 0;
+   bool hasEmptyKey = false;
+   Value emptyKeyValue{};
+
+   size_t indexOf(Key key) const { return hash(static_cast<uint64_t>(key)) & mask; }
+
+   void grow() {
+      auto old = std::move(slots);
+      slots = std::vector<Slot>(old.size() * 2, Slot{emptyKey, Value{}});
+      mask = slots.size() - 1;
+      for (const auto &slot : old) {
+         if (slot.key != emptyKey) {
+            auto i = indexOf(slot.key);
+            while (slots[i].key != emptyKey) {
+               i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+         }
+      }
+   }
+
+   public:
+   explicit FlatHashTable(size_t expectedSize = 16) {
+      size_t capacity = 16;
+      while (capacity * maxLoadFactor < expectedSize) {
+         capacity *= 2;
+      }
+      slots = std::vector<Slot>(capacity, Slot{emptyKey, Value{}});
+      mask = capacity - 1;
+   }
+
+   /// Murmur3's 64 bit finalizer. Also usable to partition keys, when the high bits are used
+   static uint64_t hash(uint64_t k) {
+      k ^= k >> 33;
+      k *= 0xff51afd7ed558ccdull;
+      k ^= k >> 33;
+      k *= 0xc4ceb9fe1a85ec53ull;
+      k ^= k >> 33;
+      return k;
+   }
+
+   /// Lookup the key. Returns nullptr, if there is no such key
+   Value* find(Key key) {
+      if (key == emptyKey) {
+         return hasEmptyKey ? &emptyKeyValue : nullptr;
+      }
+      for (auto i = indexOf(key);; i = (i + 1) & mask) {
+         if (slots[i].key == key) {
+            return &slots[i].value;
+         }
+         if (slots[i].key == emptyKey) {
+            return nullptr;
+         }
+      }
+   }
+
+   const Value* find(Key key) const { return const_cast<FlatHashTable*>(this)->find(key); }
+
+   /// Insert or overwrite the value for key. Returns true, if the key was newly inserted
+   bool insert(Key key, const Value &value) {
+      if (key == emptyKey) {
+         emptyKeyValue = value;
+         return not std::exchange(hasEmptyKey, true);
+      }
+      if (count + 1 > slots.size() * maxLoadFactor) {
+         grow();
+      }
+      for (auto i = indexOf(key);; i = (i + 1) & mask) {
+         if (slots[i].key == key) {
+            slots[i].value = value;
+            return false;
+         }
+         if (slots[i].key == emptyKey) {
+            slots[i] = Slot{key, value};
+            ++count;
+            return true;
+         }
+      }
+   }
+
+   /// Remove the key. Returns true, if the key was present
+   bool erase(Key key) {
+      if (key == emptyKey) {
+         return std::exchange(hasEmptyKey, false);
+      }
+      auto i = indexOf(key);
+      for (;; i = (i + 1) & mask) {
+         if (slots[i].key == emptyKey) {
+            return false;
+         }
+         if (slots[i].key == key) {
+            break;
+         }
+      }
+      // backward shift deletion: move following entries of the probe sequence into the hole
+      for (auto j = (i + 1) & mask; slots[j].key != emptyKey; j = (j + 1) & mask) {
+         const auto home = indexOf(slots[j].key);
+         // can the entry at j be moved to i, without passing its home slot?
+         if (((j - home) & mask) >= ((j - i) & mask)) {
+            slots[i] = slots[j];
+            i = j;
+         }
+      }
+      slots[i].key = emptyKey;
+      --count;
+      return true;
+   }
+
+   /// Prefetch the slot of key, to hide the cache miss when processing a batch of requests
+   void prefetch(Key key) const {
+      __builtin_prefetch(&slots[indexOf(key)]);
+   }
+
+   size_t size() const { return count + (hasEmptyKey ? 1 : 0); }
+};
+} // namespace datastructure
+} // namespace l5
+
+#endif //L5RDMA_FLATHASHTABLE_H
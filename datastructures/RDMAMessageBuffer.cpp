@@ -53,9 +53,9 @@ RDMAMessageBuffer::RDMAMessageBuffer(size_t size, Socket &sock) :
         net(sock),
         receiveBuffer(make_unique<volatile uint8_t[]>(size)),
         sendBuffer(make_unique<uint8_t[]>(size)),
-        localSend(net.network.registerMr(sendBuffer.get(), size, {})),
-        localReceive(net.network.registerMr(const_cast<uint8_t *>(receiveBuffer.get()), size,
-                                            {ibv::AccessFlag::LOCAL_WRITE, ibv::AccessFlag::REMOTE_WRITE})),
+        localSend(net.network.registerNumaLocalMr(sendBuffer.get(), size, {})),
+        localReceive(net.network.registerNumaLocalMr(const_cast<uint8_t *>(receiveBuffer.get()), size,
+                                                     {ibv::AccessFlag::LOCAL_WRITE, ibv::AccessFlag::REMOTE_WRITE})),
         localReadPos(net.network.registerMr(&readPos, sizeof(readPos), {ibv::AccessFlag::REMOTE_READ})),
         localCurrentRemoteReceive(
                 net.network.registerMr(const_cast<size_t *>(&currentRemoteReceive), sizeof(currentRemoteReceive),
@@ -0,0 +1,246 @@
+#include "RdmaHashIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include "util/socket/tcp.h"
+
+using Perm = ibv::AccessFlag;
+
+namespace l5 {
+namespace datastructure {
+using namespace util;
+
+/// Modify the data between version and tailVersion, so that concurrent READs can detect torn reads
+template<typename Fun>
+static void versionedWrite(uint64_t &version, uint64_t &tailVersion, Fun &&modify) {
+    auto head = std::atomic_ref<uint64_t>(version);
+    auto tail = std::atomic_ref<uint64_t>(tailVersion);
+    const auto current = head.load(std::memory_order_relaxed);
+    tail.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    modify();
+    head.store(current + 2, std::memory_order_release);
+    tail.store(current + 2, std::memory_order_release);
+}
+
+RdmaHashIndex::RdmaHashIndex(rdma::Network &network, size_t capacity, size_t valueSize) :
+        // ~2 keys per bucket, so only few buckets overflow
+        bucketCount(std::max<size_t>(capacity / 2, 1)),
+        valueSize(valueSize),
+        entrySize(rdmaHashEntrySize(valueSize)),
+        index(bucketCount, network, {Perm::REMOTE_READ}),
+        heap(std::in_place, capacity * entrySize, network, std::initializer_list<Perm>{Perm::REMOTE_READ}),
+        values(heap->data()),
+        valuesAddress(heap->getAddr()) {
+    for (auto &bucket : index) {
+        std::fill(std::begin(bucket.offsets), std::end(bucket.offsets), RdmaHashBucket::emptyOffset);
+    }
+}
+
+RdmaHashIndex::RdmaHashIndex(rdma::Network &network, size_t capacity, size_t valueSize,
+                             ibv::memoryregion::MemoryRegion &external) :
+        bucketCount(std::max<size_t>(capacity / 2, 1)),
+        valueSize(valueSize),
+        entrySize(valueSize),
+        index(bucketCount, network, {Perm::REMOTE_READ}),
+        values(reinterpret_cast<uint8_t *>(external.getAddr())),
+        valuesAddress(external.getRemoteAddress()) {
+    for (auto &bucket : index) {
+        std::fill(std::begin(bucket.offsets), std::end(bucket.offsets), RdmaHashBucket::emptyOffset);
+    }
+}
+
+std::pair<RdmaHashBucket *, size_t> RdmaHashIndex::find(uint64_t key) {
+    auto b = rdmaHashHome(key, bucketCount);
+    for (size_t probed = 0; probed < bucketCount; ++probed, b = (b + 1) % bucketCount) {
+        auto &bucket = index.data()[b];
+        for (size_t s = 0; s < RdmaHashBucket::SLOTS; ++s) {
+            if (bucket.offsets[s] != RdmaHashBucket::emptyOffset && bucket.keys[s] == key) {
+                return {&bucket, s};
+            }
+        }
+        if (not bucket.overflowed) {
+            break;
+        }
+    }
+    return {nullptr, 0};
+}
+
+void RdmaHashIndex::put(uint64_t key, const uint8_t *value) {
+    if (not heap) {
+        throw std::logic_error{"can't put values into an index over external values"};
+    }
+    const auto[found, slot] = find(key);
+    if (found != nullptr) {
+        auto e = entry(found->offsets[slot]);
+        versionedWrite(e[0], e[entrySize / sizeof(uint64_t) - 1], [&] {
+            std::memcpy(&e[2], value, valueSize);
+        });
+        return;
+    }
+
+    uint64_t offset;
+    if (not freeOffsets.empty()) {
+        offset = freeOffsets.back();
+        freeOffsets.pop_back();
+    } else if (heapUsed + entrySize <= heap->get().size()) {
+        offset = heapUsed;
+        heapUsed += entrySize;
+    } else {
+        throw std::runtime_error{"RdmaHashIndex heap is full"};
+    }
+    auto e = entry(offset);
+    versionedWrite(e[0], e[entrySize / sizeof(uint64_t) - 1], [&] {
+        e[1] = key;
+        std::memcpy(&e[2], value, valueSize);
+    });
+    try {
+        insert(key, offset);
+    } catch (...) {
+        freeOffsets.push_back(offset);
+        throw;
+    }
+}
+
+void RdmaHashIndex::putExternal(uint64_t key, uint64_t offset) {
+    if (heap) {
+        throw std::logic_error{"not an index over external values"};
+    }
+    const auto[found, slot] = find(key);
+    if (found != nullptr) {
+        versionedWrite(found->version, found->tailVersion, [&] { found->offsets[slot] = offset; });
+        return;
+    }
+    insert(key, offset);
+}
+
+void RdmaHashIndex::insert(uint64_t key, uint64_t offset) {
+    auto b = rdmaHashHome(key, bucketCount);
+    for (size_t probed = 0; probed < bucketCount; ++probed, b = (b + 1) % bucketCount) {
+        auto &bucket = index.data()[b];
+        const auto free = std::find(std::begin(bucket.offsets), std::end(bucket.offsets), RdmaHashBucket::emptyOffset);
+        if (free != std::end(bucket.offsets)) {
+            const auto s = static_cast<size_t>(free - std::begin(bucket.offsets));
+            versionedWrite(bucket.version, bucket.tailVersion, [&] {
+                bucket.keys[s] = key;
+                bucket.offsets[s] = offset;
+            });
+            return;
+        }
+        if (not bucket.overflowed) {
+            versionedWrite(bucket.version, bucket.tailVersion, [&] { bucket.overflowed = 1; });
+        }
+    }
+    throw std::runtime_error{"RdmaHashIndex is full"};
+}
+
+bool RdmaHashIndex::get(uint64_t key, uint8_t *value) {
+    const auto[found, slot] = find(key);
+    if (found == nullptr) {
+        return false;
+    }
+    if (heap) {
+        std::memcpy(value, entry(found->offsets[slot]) + 2, valueSize);
+    } else {
+        std::memcpy(value, values + found->offsets[slot], valueSize);
+    }
+    return true;
+}
+
+bool RdmaHashIndex::erase(uint64_t key) {
+    if (not heap) {
+        throw std::logic_error{"can't erase from an index over external values"};
+    }
+    const auto[found, slot] = find(key);
+    if (found == nullptr) {
+        return false;
+    }
+    const auto offset = found->offsets[slot];
+    versionedWrite(found->version, found->tailVersion, [&] {
+        found->offsets[slot] = RdmaHashBucket::emptyOffset;
+    });
+    // clients may still have the offset cached, so make sure the entry no longer matches key
+    auto e = entry(offset);
+    versionedWrite(e[0], e[entrySize / sizeof(uint64_t) - 1], [&] { e[1] = ~key; });
+    freeOffsets.push_back(offset);
+    return true;
+}
+
+RdmaHashIndexInfo RdmaHashIndex::getInfo() {
+    return RdmaHashIndexInfo{index.getAddr(), valuesAddress, bucketCount, valueSize, not heap};
+}
+
+void RdmaHashIndex::sendInfo(const Socket &sock) {
+    tcp::write(sock, getInfo());
+}
+
+RdmaHashIndexClient::RdmaHashIndexClient(RDMANetworking &net, const Socket &sock) :
+        net(net),
+        info(tcp::read<RdmaHashIndexInfo>(sock)),
+        entrySize(rdmaHashEntrySize(info)),
+        readBuffer(std::max(sizeof(RdmaHashBucket), entrySize), net.network, {Perm::LOCAL_WRITE}) {}
+
+void RdmaHashIndexClient::read(const ibv::memoryregion::RemoteAddress &remote, size_t length) {
+    ibv::workrequest::Simple<ibv::workrequest::Read> wr;
+    wr.setLocalAddress(readBuffer.getSlice(0, static_cast<uint32_t>(length)));
+    wr.setRemoteAddress(remote);
+    wr.setFlags({ibv::workrequest::Flags::SIGNALED});
+    net.queuePair.postWorkRequest(wr);
+    net.completionQueue.pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_READ);
+    ++reads;
+}
+
+uint64_t RdmaHashIndexClient::lookupOffset(uint64_t key) {
+    const auto bucket = reinterpret_cast<volatile RdmaHashBucket *>(readBuffer.data());
+    auto b = rdmaHashHome(key, info.bucketCount);
+    for (size_t probed = 0; probed < info.bucketCount;) {
+        read(info.index.offset(b * sizeof(RdmaHashBucket)), sizeof(RdmaHashBucket));
+        if (bucket->version != bucket->tailVersion) {
+            continue; // concurrently modified, retry
+        }
+        for (size_t s = 0; s < RdmaHashBucket::SLOTS; ++s) {
+            if (bucket->offsets[s] != RdmaHashBucket::emptyOffset && bucket->keys[s] == key) {
+                return bucket->offsets[s];
+            }
+        }
+        if (not bucket->overflowed) {
+            break;
+        }
+        ++probed;
+        b = (b + 1) % info.bucketCount;
+    }
+    return RdmaHashBucket::emptyOffset;
+}
+
+bool RdmaHashIndexClient::get(uint64_t key, uint8_t *value) {
+    const auto e = reinterpret_cast<volatile uint64_t *>(readBuffer.data());
+    for (;;) {
+        const auto cached = offsetCache.find(key);
+        const auto offset = cached != nullptr ? *cached : lookupOffset(key);
+        if (offset == RdmaHashBucket::emptyOffset) {
+            return false;
+        }
+
+        read(info.heap.offset(offset), entrySize);
+        if (info.external) {
+            // plain values, which the server doesn't modify
+            std::memcpy(value, readBuffer.data(), info.valueSize);
+            offsetCache.insert(key, offset);
+            return true;
+        }
+        if (e[0] != e[entrySize / sizeof(uint64_t) - 1]) {
+            continue; // concurrently modified, retry
+        }
+        if (e[1] != key) {
+            // erased or reused since we looked up the offset
+            offsetCache.erase(key);
+            continue;
+        }
+        std::memcpy(value, readBuffer.data() + 2 * sizeof(uint64_t), info.valueSize);
+        offsetCache.insert(key, offset);
+        return true;
+    }
+}
+} // namespace datastructure
+} // namespace l5
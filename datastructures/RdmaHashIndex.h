@@ -0,0 +1,157 @@
+#ifndef L5RDMA_RDMAHASHINDEX_H
+#define L5RDMA_RDMAHASHINDEX_H
+
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "datastructures/FlatHashTable.h"
+#include "rdma/MemoryRegion.h"
+#include "util/RDMANetworking.h"
+
+namespace l5 {
+namespace datastructure {
+/**
+ * Layout shared by RdmaHashIndex and RdmaHashIndexClient.
+ * The index is an array of 128 byte buckets with SLOTS (key, heap offset) pairs each, so a client can fetch a whole
+ * bucket with a single RDMA READ. Keys are placed in their home bucket, or, when it is full, in the next bucket with a
+ * free slot. Full buckets that were skipped are marked as overflowed, so lookups know when to continue.
+ * The values live in a separate heap of fixed size entries: [version][key][value][tailVersion].
+ * Buckets and entries are protected by a seqlock-like version pair: the server bumps tailVersion to an odd value
+ * before modifying, and sets version and tailVersion to the next even value afterwards. Since NICs read front to back,
+ * a READ that sees version == tailVersion is consistent.
+ * Alternatively, the index can point into external memory, e.g. a whole database, so the values aren't copied. Such
+ * values are read as they are, without versions, and the index is insert-only.
+ */
+struct alignas(64) RdmaHashBucket {
+    static constexpr size_t SLOTS = 6;
+    static constexpr uint64_t emptyOffset = std::numeric_limits<uint64_t>::max();
+
+    uint64_t version;
+    uint64_t overflowed;
+    uint64_t keys[SLOTS];
+    uint64_t offsets[SLOTS];
+    uint64_t padding;
+    uint64_t tailVersion;
+};
+static_assert(sizeof(RdmaHashBucket) == 128);
+
+/// Everything a client needs to know, to look up values in a remote RdmaHashIndex
+struct RdmaHashIndexInfo {
+    ibv::memoryregion::RemoteAddress index;
+    ibv::memoryregion::RemoteAddress heap;
+    uint64_t bucketCount;
+    uint64_t valueSize;
+    /// The heap is external memory with plain values instead of versioned entries
+    uint64_t external;
+};
+
+/// Size of one heap entry for values of valueSize
+constexpr size_t rdmaHashEntrySize(size_t valueSize) {
+    return 2 * sizeof(uint64_t) + (valueSize + 7) / 8 * 8 + sizeof(uint64_t);
+}
+
+/// Size of one entry in the heap described by info
+constexpr size_t rdmaHashEntrySize(const RdmaHashIndexInfo &info) {
+    return info.external ? info.valueSize : rdmaHashEntrySize(info.valueSize);
+}
+
+/// Home bucket of key
+inline size_t rdmaHashHome(uint64_t key, size_t bucketCount) {
+    return FlatHashTable<uint64_t, uint64_t>::hash(key) % bucketCount;
+}
+
+/**
+ * Server side: a hash index and value heap in registered memory, that clients can read with one-sided RDMA READs.
+ * Only the server modifies the data, so all modifications are local and don't need any request processing.
+ * Not thread safe, use a single writer.
+ */
+class RdmaHashIndex {
+    const size_t bucketCount;
+    const size_t valueSize;
+    const size_t entrySize;
+    rdma::RegisteredMemoryRegion<RdmaHashBucket> index;
+    /// Own heap of versioned entries, empty for an index over external values
+    std::optional<rdma::RegisteredMemoryRegion<uint8_t>> heap;
+    /// Start of the heap, or of the external values
+    uint8_t *values;
+    ibv::memoryregion::RemoteAddress valuesAddress;
+    size_t heapUsed = 0;
+    std::vector<uint64_t> freeOffsets;
+
+    /// Returns the bucket and slot of key, or {nullptr, 0}
+    std::pair<RdmaHashBucket *, size_t> find(uint64_t key);
+
+    /// Add key to the first bucket with a free slot, starting at its home bucket
+    void insert(uint64_t key, uint64_t offset);
+
+    uint64_t *entry(uint64_t offset) { return reinterpret_cast<uint64_t *>(values + offset); }
+
+public:
+    /**
+     * @param network to register the index and heap with
+     * @param capacity maximum number of keys
+     * @param valueSize size of each value in bytes
+     */
+    RdmaHashIndex(rdma::Network &network, size_t capacity, size_t valueSize);
+
+    /**
+     * Index over values in external memory, which the caller keeps registered and alive. The caller must not modify
+     * the values, while clients read them.
+     * @param external registered with REMOTE_READ, the values are at offsets given to putExternal
+     */
+    RdmaHashIndex(rdma::Network &network, size_t capacity, size_t valueSize,
+                  ibv::memoryregion::MemoryRegion &external);
+
+    /// Insert or update the value of key. value needs to be valueSize bytes. Not for an index over external values
+    void put(uint64_t key, const uint8_t *value);
+
+    /// Insert key, whose value is valueSize bytes at offset in the external values
+    void putExternal(uint64_t key, uint64_t offset);
+
+    /// Local lookup. Returns false, if there is no such key
+    bool get(uint64_t key, uint8_t *value);
+
+    /// Returns false, if there is no such key. Not for an index over external values
+    bool erase(uint64_t key);
+
+    RdmaHashIndexInfo getInfo();
+
+    /// Send the info needed by a RdmaHashIndexClient
+    void sendInfo(const util::Socket &sock);
+};
+
+/**
+ * Client side: resolves lookups with one-sided RDMA READs and without any server CPU involvement.
+ * A lookup READs the home bucket (and rarely its overflow buckets), then the value. The heap offsets of found keys are
+ * cached, so repeated lookups of a key only need the value READ. Concurrent updates are detected by the versions and
+ * retried.
+ */
+class RdmaHashIndexClient {
+    util::RDMANetworking &net;
+    RdmaHashIndexInfo info{};
+    const size_t entrySize;
+    rdma::RegisteredMemoryRegion<uint8_t> readBuffer;
+    FlatHashTable<uint64_t, uint64_t> offsetCache;
+    size_t reads = 0;
+
+    /// Blocking RDMA READ of length bytes at remote into the start of readBuffer
+    void read(const ibv::memoryregion::RemoteAddress &remote, size_t length);
+
+    /// Read the buckets of key. Returns the heap offset, or RdmaHashBucket::emptyOffset, if there is no such key
+    uint64_t lookupOffset(uint64_t key);
+
+public:
+    /// Receive the RdmaHashIndexInfo from sock and use the (already connected) queue pair of net for all READs
+    RdmaHashIndexClient(util::RDMANetworking &net, const util::Socket &sock);
+
+    /// Lookup the value of key. Returns false, if there is no such key
+    bool get(uint64_t key, uint8_t *value);
+
+    /// Number of RDMA READs issued so far
+    size_t readCount() const { return reads; }
+};
+} // namespace datastructure
+} // namespace l5
+
+#endif //L5RDMA_RDMAHASHINDEX_H
@@ -2,6 +2,7 @@
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include "util/socket/tcp.h"
 
 using Perm = ibv::AccessFlag;
 
@@ -10,32 +11,61 @@ namespace datastructure {
 static auto uuidGenerator = boost::uuids::random_generator{};
 using namespace util;
 
-VirtualRDMARingBuffer::VirtualRDMARingBuffer(size_t size, const Socket &sock) :
+template<typename QueuePair>
+BasicVirtualRDMARingBuffer<QueuePair>::BasicVirtualRDMARingBuffer(size_t size, const Socket &sock) :
         size(size), bitmask(size - 1), net(sock),
         sendBuf(mmapSharedRingBuffer(to_string(uuidGenerator()), size, true)),
         // Since we mapped twice the virtual memory, we can create memory regions of twice the size of the actual buffer
-        localSendMr(net.network.registerMr(sendBuf.data.get(), size * 2, {})),
+        localSendMr(net.network.registerNumaLocalMr(sendBuf.data.get(), size * 2, {})),
         localReadPosMr(net.network.registerMr(&localReadPos, sizeof(localReadPos), {Perm::REMOTE_READ})),
         receiveBuf(mmapSharedRingBuffer(to_string(uuidGenerator()), size, true)),
-        localReceiveMr(net.network.registerMr(receiveBuf.data.get(), size * 2, {Perm::LOCAL_WRITE, Perm::REMOTE_WRITE})),
-        remoteReadPosMr(net.network.registerMr(&remoteReadPos, sizeof(remoteReadPos), {Perm::LOCAL_WRITE})) {
+        localReceiveMr(net.network.registerNumaLocalMr(receiveBuf.data.get(), size * 2,
+                                                       {Perm::LOCAL_WRITE, Perm::REMOTE_WRITE})),
+        // unreliable connections can't read the remote read position, instead the receiver writes it to us
+        remoteReadPosMr(reliable
+                        ? net.network.registerMr(&remoteReadPos, sizeof(remoteReadPos), {Perm::LOCAL_WRITE})
+                        : net.network.registerMr(&remoteReadPos, sizeof(remoteReadPos),
+                                                 {Perm::LOCAL_WRITE, Perm::REMOTE_WRITE})) {
     const bool powerOfTwo = (size != 0) && !(size & (size - 1));
     if (not powerOfTwo) {
         throw std::runtime_error{"size should be a power of 2"};
     }
 
-    sendRmrInfo(sock, *localReceiveMr, *localReadPosMr);
-    receiveAndSetupRmr(sock, remoteReceiveRmr, remoteReadPosRmr);
+    if constexpr (reliable) {
+        sendRmrInfo(sock, *localReceiveMr, *localReadPosMr);
+        receiveAndSetupRmr(sock, remoteReceiveRmr, remoteReadPosRmr);
+
+        finishedRendezvousMr = net.network.registerMr(&finishedRendezvous, sizeof(finishedRendezvous),
+                                                      {Perm::LOCAL_WRITE, Perm::REMOTE_WRITE});
+        receivedRendezvousMr = net.network.registerMr(&receivedRendezvous, sizeof(receivedRendezvous), {});
+        tcp::write(sock, finishedRendezvousMr->getRemoteAddress());
+        tcp::read(sock, remoteFinishedRendezvousRmr);
+    } else {
+        // remoteReadPosRmr is where we write our read position to
+        sendRmrInfo(sock, *localReceiveMr, *remoteReadPosMr);
+        receiveAndSetupRmr(sock, remoteReceiveRmr, remoteReadPosRmr);
+
+        localSendPositionMr = net.network.registerMr(&localSendPosition, sizeof(localSendPosition), {});
+        sendHistoryMr = net.network.registerMr(sendHistory.data(), sizeof(sendHistory),
+                                               {Perm::LOCAL_WRITE, Perm::REMOTE_WRITE});
+        tcp::write(sock, sendHistoryMr->getRemoteAddress());
+        tcp::read(sock, remoteSendHistoryRmr);
+
+        sendPositionWr.setLocalAddress(localSendPositionMr->getSlice());
+        sendPositionWr.setInline();
+    }
 }
 
-void VirtualRDMARingBuffer::send(const uint8_t *data, size_t length) {
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::send(const uint8_t *data, size_t length) {
     send([&](auto writeBegin) {
         std::copy(data, data + length, writeBegin);
         return length;
     });
 }
 
-size_t VirtualRDMARingBuffer::receive(void *whereTo, size_t maxSize) {
+template<typename QueuePair>
+size_t BasicVirtualRDMARingBuffer<QueuePair>::receive(void *whereTo, size_t maxSize) {
     const auto maxSizeToRead = sizeof(maxSize) + maxSize + sizeof(validity);
     if (maxSizeToRead > size) throw std::runtime_error{"receiveSize > buffersize!"};
     size_t receiveSize;
@@ -52,9 +82,193 @@ size_t VirtualRDMARingBuffer::receive(void *whereTo, size_t maxSize) {
     return receiveSize;
 }
 
-void VirtualRDMARingBuffer::waitUntilSendFree(size_t sizeToWrite) {
+template<typename QueuePair>
+size_t BasicVirtualRDMARingBuffer<QueuePair>::receiveSome(void *whereTo, size_t maxSize) {
+    const auto header = waitForMessage();
+    const auto message = &receiveBuf.data.get()[(localReadPos.load() & bitmask) + sizeof(header)];
+    if constexpr (supportsRendezvous) {
+        if (header & rendezvousFlag) {
+            auto descriptor = RendezvousDescriptor{};
+            std::memcpy(&descriptor, message, sizeof(descriptor));
+            return receiveRendezvous(descriptor, whereTo, maxSize);
+        }
+    }
+
+    const auto begin = message + receiveOffset;
+    const auto chunk = std::min(header - receiveOffset, maxSize);
+    std::copy(begin, begin + chunk, reinterpret_cast<uint8_t *>(whereTo));
+
+    receiveOffset += chunk;
+    if (receiveOffset == header) {
+        releaseMessage(header);
+        counters.received(header);
+    }
+    return chunk;
+}
+
+template<typename QueuePair>
+size_t BasicVirtualRDMARingBuffer<QueuePair>::receiveRendezvous(const RendezvousDescriptor &descriptor, void *whereTo,
+                                                                size_t maxSize) {
+    const auto chunk = std::min(descriptor.length - receiveOffset, maxSize);
+    const auto destination = reinterpret_cast<uint8_t *>(whereTo);
+    if (chunk > 0) {
+        if (not rendezvousStaging.empty()) {
+            // an earlier piece already read the rest of the data
+            const auto begin = &rendezvousStaging[receiveOffset - stagingOffset];
+            std::copy(begin, begin + chunk, destination);
+        } else if (auto mr = registrationCache.find(whereTo, chunk)) {
+            readRendezvous(descriptor, destination, chunk, *mr);
+        } else if (receiveOffset + chunk == descriptor.length) {
+            // registering the destination once is cheaper than copying the data
+            auto temporary = net.network.getProtectionDomain().registerMemoryRegion(whereTo, chunk,
+                                                                                    {Perm::LOCAL_WRITE});
+            readRendezvous(descriptor, destination, chunk, *temporary);
+        } else {
+            // registering each (probably small) piece is way more expensive than copying, so read the rest at once
+            rendezvousStaging.resize(descriptor.length - receiveOffset);
+            stagingOffset = receiveOffset;
+            auto temporary = net.network.getProtectionDomain().registerMemoryRegion(rendezvousStaging.data(),
+                                                                                    rendezvousStaging.size(),
+                                                                                    {Perm::LOCAL_WRITE});
+            readRendezvous(descriptor, rendezvousStaging.data(), rendezvousStaging.size(), *temporary);
+            finishRendezvous(); // the sender doesn't need to wait, until we copied all pieces
+            std::copy(rendezvousStaging.begin(), rendezvousStaging.begin() + chunk, destination);
+        }
+    }
+
+    receiveOffset += chunk;
+    if (receiveOffset == descriptor.length) {
+        const auto staged = not rendezvousStaging.empty();
+        rendezvousStaging = std::vector<uint8_t>();
+        releaseMessage(sizeof(descriptor));
+        counters.received(descriptor.length);
+        if (not staged) {
+            finishRendezvous();
+        }
+    }
+    return chunk;
+}
+
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::readRendezvous(const RendezvousDescriptor &descriptor, uint8_t *whereTo,
+                                                            size_t length, const ibv::memoryregion::MemoryRegion &mr) {
+    finishReadPosRefresh();
+
+    // a single work request can't transfer more than 2GB
+    static constexpr size_t maxReadSize = size_t(1) << 30;
+    const auto destination = reinterpret_cast<uintptr_t>(whereTo);
+    for (size_t offset = 0; offset < length; offset += maxReadSize) {
+        const auto readSize = std::min(length - offset, maxReadSize);
+        ibv::workrequest::Simple<ibv::workrequest::Read> wr;
+        wr.setLocalAddress(ibv::memoryregion::Slice{destination + offset, static_cast<uint32_t>(readSize),
+                                                    mr.getLkey()});
+        wr.setRemoteAddress(ibv::memoryregion::RemoteAddress{descriptor.address + receiveOffset + offset,
+                                                             descriptor.rkey});
+        if (offset + readSize == length) {
+            wr.setSignaled();
+            wr.setId(rendezvousReadId);
+        }
+        net.queuePair.postWorkRequest(wr);
+    }
+    // the reads of the data complete in order, so the last one's completion covers all of them
+    while (counters.poll(net.completionQueue.pollSendCompletionQueue()) != rendezvousReadId);
+}
+
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::finishRendezvous() {
+    // unsignaled, the next rendezvous read's completion clears it from the queue
+    ++receivedRendezvous;
+    ibv::workrequest::Simple<ibv::workrequest::Write> wr;
+    wr.setLocalAddress(receivedRendezvousMr->getSlice());
+    wr.setRemoteAddress(remoteFinishedRendezvousRmr);
+    wr.setInline();
+    net.queuePair.postWorkRequest(wr);
+    counters.add(Stat::InlinedWrs);
+}
+
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::sendRendezvous(const uint8_t *data, size_t length) {
+    if constexpr (not supportsRendezvous) {
+        throw std::runtime_error{"rendezvous needs RDMA reads, which unreliable connections don't support"};
+    } else {
+        rdma::MemoryRegion temporary;
+        auto &mr = registrationCache.findOrRegister(data, length, {Perm::REMOTE_READ}, temporary);
+        const auto descriptor = RendezvousDescriptor{reinterpret_cast<uintptr_t>(data), mr.getRkey(), length};
+        sendMessage([&](auto begin) {
+            const auto bytes = reinterpret_cast<const uint8_t *>(&descriptor);
+            std::copy(bytes, bytes + sizeof(descriptor), begin);
+            return sizeof(descriptor);
+        }, rendezvousFlag);
+        ++sentRendezvous;
+
+        // the receiver reads straight from data, which the caller may reuse, as soon as we return
+        uint64_t spins = 0;
+        for (; finishedRendezvous.load() < sentRendezvous; ++spins);
+        counters.add(Stat::WaitSpins, spins);
+        counters.sent(length);
+    }
+}
+
+template<typename QueuePair>
+bool BasicVirtualRDMARingBuffer<QueuePair>::sendAvailable(size_t length) {
+    const auto sizeToWrite = sizeof(size) + length + sizeof(validity);
+    if (sizeToWrite <= size - (sendPos - remoteReadPos.load())) {
+        return true;
+    }
+    if constexpr (not reliable) {
+        return false; // the receiver reports its read position by itself
+    }
+
+    if (not readPosInFlight) {
+        ibv::workrequest::Simple<ibv::workrequest::Read> wr;
+        wr.setLocalAddress(remoteReadPosMr->getSlice());
+        wr.setRemoteAddress(remoteReadPosRmr);
+        wr.setFlags({ibv::workrequest::Flags::SIGNALED});
+        wr.setId(42);
+        net.queuePair.postWorkRequest(wr);
+        readPosInFlight = true;
+    } else if (counters.poll(net.completionQueue.pollSendCompletionQueue()) == 42) {
+        readPosInFlight = false;
+    }
+
+    return sizeToWrite <= size - (sendPos - remoteReadPos.load());
+}
+
+template<typename QueuePair>
+bool BasicVirtualRDMARingBuffer<QueuePair>::receiveAvailable() const {
+    const auto startOfRead = localReadPos.load() & bitmask;
+    const auto receiveSize = *reinterpret_cast<volatile size_t *>(&receiveBuf.data.get()[startOfRead]) &
+                             ~rendezvousFlag;
+    if (sizeof(receiveSize) + receiveSize + sizeof(validity) > size) {
+        return false; // size not yet completely written
+    }
+    const auto checkMe = *reinterpret_cast<volatile size_t *>(&receiveBuf.data.get()[startOfRead + sizeof(size_t) +
+            receiveSize]);
+    return checkMe == marker(receiveCounter);
+}
+
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::finishReadPosRefresh() {
+    if (readPosInFlight) {
+        while (counters.poll(net.completionQueue.pollSendCompletionQueue()) != 42);
+        readPosInFlight = false;
+    }
+}
+
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::waitUntilSendFree(size_t sizeToWrite) {
     // Make sure, there is enough space
     size_t safeToWrite = size - (sendPos - remoteReadPos.load());
+    if (sizeToWrite > safeToWrite) {
+        counters.add(Stat::SendStalls);
+    }
+    if constexpr (not reliable) {
+        // wait for the receiver to report its read position
+        uint64_t spins = 0;
+        for (; sizeToWrite > size - (sendPos - remoteReadPos.load()); ++spins);
+        counters.add(Stat::WaitSpins, spins);
+        return;
+    }
     while (sizeToWrite > safeToWrite) {
         ibv::workrequest::Simple<ibv::workrequest::Read> wr;
         wr.setLocalAddress(remoteReadPosMr->getSlice());
@@ -63,10 +277,89 @@ void VirtualRDMARingBuffer::waitUntilSendFree(size_t sizeToWrite) {
         wr.setId(42);
         net.queuePair.postWorkRequest(wr);
 
-        while (net.completionQueue.pollSendCompletionQueue() != 42); // Poll until read has finished
+        while (counters.poll(net.completionQueue.pollSendCompletionQueue()) != 42); // Poll until read has finished
         // Poll until read has finished
         safeToWrite = size - (sendPos - remoteReadPos.load());
     }
 }
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::skipDroppedMessages(bool repeatReport) {
+    // report everything we consumed while idle, and repeat the last report once in a while, it might have been
+    // dropped as well, and a waiting sender would never learn about the free space
+    if (repeatReport || localReadPos.load() != reportedReadPos) {
+        reportReadPos(true);
+    }
+
+    // read the history *before* checking the message, so the message can't be in flight anymore
+    const auto sent = oldestSentMessage();
+    const auto readPos = localReadPos.load();
+    if (not sent || receiveAvailable()) {
+        return;
+    }
+
+    // the message we wait for was sent, but didn't arrive: skip exactly that message. If its history entry got lost
+    // as well, everything before the oldest message, that we know about, is unreachable without the dropped sizes
+    const auto skipTo = sent->beginSequence == receiveCounter ? sent->endPos : sent->beginPos;
+    const auto nextSequence = sent->beginSequence == receiveCounter ? receiveCounter + 1 : sent->beginSequence;
+    if (skipTo <= readPos) {
+        return; // inconsistent with our read position, so a stale entry
+    }
+
+    // clear partially written data, so it isn't mistaken for the next messages
+    const auto startOfRead = readPos & bitmask;
+    std::fill(&receiveBuf.data.get()[startOfRead], &receiveBuf.data.get()[startOfRead + (skipTo - readPos)], 0);
+    counters.add(Stat::DroppedMessages, nextSequence - receiveCounter);
+    receiveCounter = nextSequence;
+    localReadPos.store(skipTo, std::memory_order_release);
+}
+
+template<typename QueuePair>
+auto BasicVirtualRDMARingBuffer<QueuePair>::oldestSentMessage() const -> std::optional<SendPosition> {
+    std::optional<SendPosition> oldest;
+    for (const auto &entry : sendHistory) {
+        SendPosition written;
+        do {
+            written.endSequence = *reinterpret_cast<const volatile size_t *>(&entry.endSequence);
+            written.endPos = *reinterpret_cast<const volatile size_t *>(&entry.endPos);
+            written.beginPos = *reinterpret_cast<const volatile size_t *>(&entry.beginPos);
+            written.beginSequence = *reinterpret_cast<const volatile size_t *>(&entry.beginSequence);
+        } while (written.beginSequence != written.endSequence);
+
+        // empty entries have no length, and entries of older messages than the one we wait for are stale
+        if (written.endPos > written.beginPos && written.beginSequence >= receiveCounter &&
+            (not oldest || written.beginSequence < oldest->beginSequence)) {
+            oldest = written;
+        }
+    }
+    return oldest;
+}
+
+template<typename QueuePair>
+void BasicVirtualRDMARingBuffer<QueuePair>::reportReadPos(bool force) {
+    const auto readPos = localReadPos.load();
+    if (not force && readPos - reportedReadPos < size / 4) {
+        return;
+    }
+
+    ibv::workrequest::Simple<ibv::workrequest::Write> wr;
+    wr.setLocalAddress(localReadPosMr->getSlice());
+    wr.setRemoteAddress(remoteReadPosRmr);
+    wr.setInline();
+    const auto shouldClearQueue = ++reportCounter % 1024 == 0;
+    if (shouldClearQueue) {
+        wr.setSignaled();
+    }
+    net.queuePair.postWorkRequest(wr);
+    counters.add(Stat::InlinedWrs);
+    reportedReadPos = readPos;
+
+    if (shouldClearQueue) {
+        net.completionQueue.waitForCompletion();
+        counters.add(Stat::Completions);
+    }
+}
+
+template class BasicVirtualRDMARingBuffer<rdma::RcQueuePair>;
+template class BasicVirtualRDMARingBuffer<rdma::UcQueuePair>;
 } // namespace datastructure
 } // namespace l5
@@ -1,22 +1,69 @@
 #ifndef L5RDMA_VIRTUALRDMARINGBUFFER_H
 #define L5RDMA_VIRTUALRDMARINGBUFFER_H
 
+#include <array>
 #include <atomic>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include "rdma/RegistrationCache.h"
 #include "util/RDMANetworking.h"
+#include "util/Tracepoints.h"
+#include "util/TransportStats.h"
 #include "util/virtualMemory.h"
 
 namespace l5 {
 namespace datastructure {
 
-class VirtualRDMARingBuffer {
+/**
+ * Ring buffer, that the sender writes into remotely. QueuePair is either a reliable rdma::RcQueuePair, or an
+ * unreliable rdma::UcQueuePair, which saves the ACK traffic, but may silently drop writes and can't do RDMA reads:
+ * - Flow control: the receiver writes its read position back to the sender, instead of the sender reading it
+ * - Drop detection: the end of message marker also encodes a sequence number, so a partially written message is never
+ *   taken as complete. After each message, the sender writes where the message begins and ends into a small history
+ *   on the receiver, indexed by the sequence number. When the history shows, that the message at the read position
+ *   was sent, but it still isn't complete, it was dropped, and the receiver skips exactly that message. Only if the
+ *   dropped message's history entry was lost as well, the receiver resyncs at the oldest message it knows about.
+ * Reliable connections can also transfer large messages without copying them through the ring (see sendRendezvous).
+ */
+template<typename QueuePair>
+class BasicVirtualRDMARingBuffer {
+    static constexpr bool reliable = not std::is_same_v<QueuePair, rdma::UcQueuePair>;
     static constexpr size_t validity = 0xDEADDEADBEEFBEEF;
+    /// Set in the size of a message, which only describes where the receiver can read the actual data from
+    static constexpr size_t rendezvousFlag = size_t(1) << 63;
+    static constexpr uint64_t rendezvousReadId = 43;
+
+    /// The payload of a rendezvous message
+    struct RendezvousDescriptor {
+        uint64_t address;
+        uint32_t rkey;
+        uint64_t length;
+    };
+
+    /// Where a message begins and ends, written like a seqlock: readers only trust it, if both sequence numbers
+    /// match, which relies on the front-to-back writes, that the ring buffer relies on anyways
+    struct SendPosition {
+        size_t beginSequence;
+        size_t beginPos;
+        size_t endPos;
+        size_t endSequence;
+    };
+    /// Entries of the receiver's SendPosition history, message i's is at i % sendHistorySize
+    static constexpr size_t sendHistorySize = 64;
+
     const size_t size;
     const size_t bitmask;
-    util::RDMANetworking net;
+    util::BasicRDMANetworking<QueuePair> net;
 
     size_t messageCounter = 0;
     size_t sendPos = 0;
+    /// Whether an asynchronous read of the remote read position (posted in sendAvailable) is still in flight
+    bool readPosInFlight = false;
     std::atomic<size_t> localReadPos = 0;
+    /// Bytes of the message at localReadPos (or of a rendezvous message's data), that receiveSome already handed out
+    size_t receiveOffset = 0;
     util::WraparoundBuffer sendBuf;
     rdma::MemoryRegion localSendMr;
     rdma::MemoryRegion localReadPosMr;
@@ -28,31 +75,113 @@ class VirtualRDMARingBuffer {
 
     ibv::memoryregion::RemoteAddress remoteReceiveRmr{};
     ibv::memoryregion::RemoteAddress remoteReadPosRmr{};
+
+    // only used by unreliable connections
+    /// Sequence number of the next message to receive
+    size_t receiveCounter = 0;
+    /// The read position, that the sender last got from us
+    size_t reportedReadPos = 0;
+    size_t reportCounter = 0;
+    SendPosition localSendPosition{};
+    rdma::MemoryRegion localSendPositionMr;
+    /// The positions of the remote end's latest messages
+    std::array<SendPosition, sendHistorySize> sendHistory{};
+    rdma::MemoryRegion sendHistoryMr;
+    ibv::memoryregion::RemoteAddress remoteSendHistoryRmr{};
+    ibv::workrequest::Simple<ibv::workrequest::Write> sendPositionWr;
+    /// See dropNextMessage
+    bool dropNext = false;
+
+    // only used by reliable connections
+    rdma::RegistrationCache registrationCache{net.network};
+    /// Our rendezvous messages, that the receiver completely read, written by the receiver
+    std::atomic<size_t> finishedRendezvous = 0;
+    rdma::MemoryRegion finishedRendezvousMr;
+    size_t sentRendezvous = 0;
+    /// The remote end's rendezvous messages, that we completely read
+    size_t receivedRendezvous = 0;
+    rdma::MemoryRegion receivedRendezvousMr;
+    ibv::memoryregion::RemoteAddress remoteFinishedRendezvousRmr{};
+    /// The rest of a rendezvous message's data, from stagingOffset on, when it's received in unregistered pieces
+    std::vector<uint8_t> rendezvousStaging;
+    size_t stagingOffset = 0;
+
+    util::StatCounters counters{reliable ? "rdma" : "unreliable rdma"};
 public:
+    /// Only reliable connections support RDMA reads
+    static constexpr bool supportsRendezvous = reliable;
+
     /// Establish a shared memory region of size with the remote side of sock
-    VirtualRDMARingBuffer(size_t size, const util::Socket &sock);
+    BasicVirtualRDMARingBuffer(size_t size, const util::Socket &sock);
 
     void send(const uint8_t *data, size_t length);
 
+    /**
+     * Send a large message without copying it through the ring: only a descriptor of data goes through the ring, and
+     * the receiver reads the data with RDMA reads straight into its destination. Returns, when the receiver read all
+     * of it, so data can be reused afterwards. Registers data for the duration of the transfer, unless it's in
+     * registrations().
+     * Other than send, this is a synchronous round trip: it blocks until the remote end receives, so both ends must not
+     * send a rendezvous message before receiving.
+     */
+    void sendRendezvous(const uint8_t *data, size_t length);
+
+    /// Buffers, that stay registered for rendezvous transfers from and to them
+    rdma::RegistrationCache &registrations() { return registrationCache; }
+
     size_t receive(void *whereTo, size_t maxSize);
 
+    /// Streaming receive: copies up to maxSize byte of the next message and keeps the rest of it for the next call.
+    /// Returns the number of copied bytes. Messages of any size can be read this way, in pieces of any size
+    size_t receiveSome(void *whereTo, size_t maxSize);
+
+    /// Whether receiveSome stopped in the middle of a message
+    bool hasPartialMessage() const { return receiveOffset != 0; }
+
+    /// Non-blocking check, if a message of length can be sent without waiting for the remote end.
+    /// Refreshes the remote read position asynchronously, so calling this repeatedly eventually returns true
+    bool sendAvailable(size_t length);
+
+    /// Non-blocking check, if a complete message is available to receive
+    bool receiveAvailable() const;
+
+    util::TransportStats stats() const { return counters.snapshot(); }
+
+    /// Fault injection for tests of unreliable connections: the next message takes up its space in the ring and its
+    /// sequence number, but only the send position is written, as if the network dropped the message itself
+    void dropNextMessage() {
+        if constexpr (reliable) {
+            throw std::runtime_error{"reliable connections don't drop messages"};
+        }
+        dropNext = true;
+    }
+
     /// send data via a lambda to enable zerocopy operation
     /// expected signature: [](uint8_t* begin) -> size_t
     template<typename SizeReturner>
     void send(SizeReturner &&doWork) {
+        counters.sent(sendMessage(std::forward<SizeReturner>(doWork), 0));
+    }
+
+private:
+    /// Returns the size of the message, which is flagged with headerFlags
+    template<typename SizeReturner>
+    size_t sendMessage(SizeReturner &&doWork, size_t headerFlags) {
         static_assert(std::is_unsigned_v<std::result_of_t<SizeReturner(uint8_t *)>>);
         const auto startOfWrite = sendPos & bitmask;
         auto sizePtr = reinterpret_cast<volatile size_t *>(&sendBuf.data.get()[startOfWrite]);
         auto begin = reinterpret_cast<volatile uint8_t *>(sizePtr + 1);
 
         // let the caller do the data stuff
+        L5_TRACE(rdma_send_work_begin, messageCounter);
         const size_t dataSize = doWork(begin);
+        L5_TRACE(rdma_send_work_end, messageCounter, dataSize);
         const auto sizeToWrite = sizeof(size) + dataSize + sizeof(validity);
         if (sizeToWrite > size) throw std::runtime_error{"data > buffersize!"};
 
-        *sizePtr = dataSize;
+        *sizePtr = dataSize | headerFlags;
         auto validityPtr = reinterpret_cast<volatile size_t *>(begin + dataSize);
-        *validityPtr = validity;
+        *validityPtr = marker(messageCounter);
 
         // actually send the message via rdma (similar to send)
         const auto sendSlice = localSendMr->getSlice(startOfWrite, sizeToWrite);
@@ -67,19 +196,40 @@ public:
         }
         if (sendSlice.length <= net.queuePair.getMaxInlineSize()) {
             wr.setInline();
+            counters.add(util::Stat::InlinedWrs);
         }
+        chainSendPosition(wr, sendPos + sizeToWrite);
+        L5_TRACE(rdma_send_wait_begin, messageCounter);
+        finishReadPosRefresh();
         waitUntilSendFree(sizeToWrite);
-        net.queuePair.postWorkRequest(wr);
+        L5_TRACE(rdma_send_wait_end, messageCounter);
+        L5_TRACE(rdma_post_begin, messageCounter, sizeToWrite);
+        if (dropNext) {
+            dropNext = false;
+            auto positionOnly = sendPositionWr;
+            positionOnly.setLocalAddress(localSendPositionMr->getSlice());
+            if (shouldClearQueue) {
+                positionOnly.setSignaled();
+            }
+            net.queuePair.postWorkRequest(positionOnly);
+        } else {
+            net.queuePair.postWorkRequest(wr);
+        }
+        L5_TRACE(rdma_post_end, messageCounter);
 
         if (shouldClearQueue) {
             net.completionQueue.waitForCompletion();
+            counters.add(util::Stat::Completions);
         }
         ++messageCounter;
 
         // finally, update sendPos
         sendPos += sizeToWrite;
+        counters.set(util::Stat::RingOccupancy, sendPos - remoteReadPos.load());
+        return dataSize;
     }
 
+public:
     /// RFC 5040 compliant version that uses two separate writes that are explicitly ordered.
     /// Would be needed for exotic implementations that don't write messages front-to-back, but is unused by default
     template<typename SizeReturner>
@@ -90,14 +240,16 @@ public:
         auto begin = reinterpret_cast<volatile uint8_t *>(sizePtr + 1);
 
         // let the caller fill the data
+        L5_TRACE(rdma_send_work_begin, messageCounter);
         const size_t dataSize = doWork(begin);
+        L5_TRACE(rdma_send_work_end, messageCounter, dataSize);
         const auto sizeSize = sizeof(size);
         const auto dataSizeToWrite = dataSize + sizeof(validity);
         if (sizeSize + dataSizeToWrite > size) throw std::runtime_error{"data > buffersize!"};
 
         *sizePtr = dataSize;
         auto validityPtr = reinterpret_cast<volatile size_t *>(begin + dataSize);
-        *validityPtr = validity;
+        *validityPtr = marker(messageCounter);
 
         // first the data
         const auto dataSlice = localSendMr->getSlice(startOfWrite + sizeSize, dataSizeToWrite);
@@ -113,61 +265,166 @@ public:
         dataWr.setRemoteAddress(remoteDataSlice);
         if (dataSlice.length <= net.queuePair.getMaxInlineSize()) {
             dataWr.setInline();
+            counters.add(util::Stat::InlinedWrs);
         }
 
         auto sizeWr = ibv::workrequest::Simple<ibv::workrequest::Write>();
         sizeWr.setLocalAddress(sizeSlice);
         sizeWr.setRemoteAddress(remoteSizeSlice);
         sizeWr.setInline();
+        counters.add(util::Stat::InlinedWrs);
         if (shouldClearQueue) {
             sizeWr.setSignaled();
         }
+        chainSendPosition(sizeWr, sendPos + sizeSize + dataSizeToWrite);
 
+        L5_TRACE(rdma_send_wait_begin, messageCounter);
+        finishReadPosRefresh();
         waitUntilSendFree(sizeSize + dataSizeToWrite);
+        L5_TRACE(rdma_send_wait_end, messageCounter);
         // significant order: size is only visible after data
+        L5_TRACE(rdma_post_begin, messageCounter, sizeSize + dataSizeToWrite);
         net.queuePair.postWorkRequest(dataWr);
         net.queuePair.postWorkRequest(sizeWr);
+        L5_TRACE(rdma_post_end, messageCounter);
 
         if (shouldClearQueue) {
             net.completionQueue.waitForCompletion();
+            counters.add(util::Stat::Completions);
         }
         ++messageCounter;
+        counters.sent(dataSize);
 
         // finally, update sendPos
         sendPos += sizeSize + dataSizeToWrite;
+        counters.set(util::Stat::RingOccupancy, sendPos - remoteReadPos.load());
     }
 
-    /// receive data via a lambda to enable zerocopy operation
+    /// receive data via a lambda to enable zerocopy operation. After a receiveSome, only the rest of the message
     /// expected signature: [](const uint8_t* begin, const uint8_t* end) -> void
     template<typename RangeConsumer>
     void receive(RangeConsumer &&callback) {
         static_assert(std::is_void_v<std::result_of_t<RangeConsumer(const uint8_t *, const uint8_t *)>>);
-        const auto lastReadPos = localReadPos.load();
-        const auto startOfRead = lastReadPos & bitmask;
+        const auto header = waitForMessage();
+        const auto begin = &receiveBuf.data.get()[(localReadPos.load() & bitmask) + sizeof(header)];
+        if constexpr (supportsRendezvous) {
+            if (header & rendezvousFlag) {
+                // the data isn't in the ring, so read it into a temporary buffer for the callback
+                auto descriptor = RendezvousDescriptor{};
+                std::memcpy(&descriptor, begin, sizeof(descriptor));
+                auto data = std::vector<uint8_t>(descriptor.length - receiveOffset);
+                size_t i = 0;
+                do {
+                    i += receiveSome(data.data() + i, data.size() - i);
+                } while (i < data.size());
+                callback(data.data(), data.data() + data.size());
+                return;
+            }
+        }
+
+        // let the caller do the data stuff
+        callback(begin + receiveOffset, begin + header);
+
+        releaseMessage(header);
+        counters.received(header);
+    }
+
+private:
+    /// Spins until the message at localReadPos is complete, returns its size, including the rendezvousFlag
+    size_t waitForMessage() {
+        auto lastReadPos = localReadPos.load();
+        auto startOfRead = lastReadPos & bitmask;
 
+        size_t header;
         size_t receiveSize;
         size_t checkMe;
-        do {
-            receiveSize = *reinterpret_cast<volatile size_t *>(&receiveBuf.data.get()[startOfRead]);
+        uint64_t spins = 0;
+        L5_TRACE(rdma_receive_spin_begin, lastReadPos);
+        for (;; ++spins) {
+            if constexpr (not reliable) {
+                if (spins % 64 == 63) {
+                    skipDroppedMessages(spins % (64 * 1024) == 64 * 1024 - 1);
+                    lastReadPos = localReadPos.load();
+                    startOfRead = lastReadPos & bitmask;
+                }
+            }
+            header = *reinterpret_cast<volatile size_t *>(&receiveBuf.data.get()[startOfRead]);
+            receiveSize = header & ~rendezvousFlag;
             checkMe = *reinterpret_cast<volatile size_t *>(&receiveBuf.data.get()[startOfRead + sizeof(size_t) +
                     receiveSize]);
-        } while (checkMe != validity);
-
-        const auto begin = &receiveBuf.data.get()[startOfRead + sizeof(receiveSize)];
-        const auto end = begin + receiveSize;
-
-        // let the caller do the data stuff
-        callback(begin, end);
+            if (checkMe == marker(receiveCounter)) break;
+        }
+        L5_TRACE(rdma_receive_spin_end, lastReadPos, receiveSize);
+        counters.add(util::Stat::WaitSpins, spins);
+        return header;
+    }
 
+    /// Frees the (completely consumed) message of receiveSize byte in the ring at localReadPos
+    void releaseMessage(size_t receiveSize) {
+        const auto lastReadPos = localReadPos.load();
+        const auto startOfRead = lastReadPos & bitmask;
         const auto totalSizeRead = sizeof(receiveSize) + receiveSize + sizeof(validity);
         std::fill(&receiveBuf.data.get()[startOfRead], &receiveBuf.data.get()[startOfRead + totalSizeRead], 0);
 
+        receiveOffset = 0;
         localReadPos.store(lastReadPos + totalSizeRead, std::memory_order_release);
+        if constexpr (not reliable) {
+            ++receiveCounter;
+            reportReadPos(false);
+        }
     }
 
-private:
+    /// The end of message marker. Unreliable connections also encode the message's sequence number
+    static constexpr size_t marker(size_t sequence) {
+        if constexpr (reliable) {
+            return validity;
+        } else {
+            return validity ^ sequence;
+        }
+    }
+
+    /// On unreliable connections, every message (starting at sendPos) is followed by a write of its position into the
+    /// receiver's history
+    void chainSendPosition(ibv::workrequest::SendWr &last, size_t endPos) {
+        if constexpr (not reliable) {
+            localSendPosition = SendPosition{messageCounter, sendPos, endPos, messageCounter};
+            sendPositionWr.setRemoteAddress(
+                    remoteSendHistoryRmr.offset((messageCounter % sendHistorySize) * sizeof(SendPosition)));
+            last.setNext(&sendPositionWr); // inlined, so the next message may overwrite localSendPosition right away
+        }
+    }
+
+    /// Unreliable connections: skip messages, that the sender already wrote, but that never (completely) arrived
+    void skipDroppedMessages(bool repeatReport);
+
+    /// The history entry of the oldest message, that was sent since the one we wait for, if any
+    std::optional<SendPosition> oldestSentMessage() const;
+
+    /// Unreliable connections: write our read position to the sender, when a quarter of the buffer was freed since
+    /// the last report, or always on force
+    void reportReadPos(bool force);
+
     void waitUntilSendFree(size_t sizeToWrite);
+
+    /// Wait for an outstanding asynchronous read of the remote read position, so its completion isn't swallowed
+    void finishReadPosRefresh();
+
+    /// receiveSome for a rendezvous message: RDMA reads the next up to maxSize byte of the data, that descriptor
+    /// describes, and tells the sender, when all of it was read. Registers at most one buffer per message: a piece,
+    /// that isn't the rest of the data, and whose destination isn't in registrations(), reads the rest into a staging
+    /// buffer instead
+    size_t receiveRendezvous(const RendezvousDescriptor &descriptor, void *whereTo, size_t maxSize);
+
+    /// RDMA reads length byte of the data, that descriptor describes, from receiveOffset on
+    void readRendezvous(const RendezvousDescriptor &descriptor, uint8_t *whereTo, size_t length,
+                        const ibv::memoryregion::MemoryRegion &mr);
+
+    /// Let the sender reuse its buffer, after we read all of it
+    void finishRendezvous();
 };
+
+using VirtualRDMARingBuffer = BasicVirtualRDMARingBuffer<rdma::RcQueuePair>;
+using UnreliableVirtualRDMARingBuffer = BasicVirtualRDMARingBuffer<rdma::UcQueuePair>;
 } // namespace datastructure
 } // namespace l5
 
@@ -34,10 +34,14 @@ VirtualRingBuffer::VirtualRingBuffer(size_t size, const Socket &sock) : size(siz
 
 void VirtualRingBuffer::waitUntilSendFree(size_t localWritten, size_t length) {
     // Don't read the remote memory if we don't have to
-    if ((localWritten - cachedRemoteRead) > (size - length)) return;
-    loop_while([&]() {
+    if ((localWritten - cachedRemoteRead) <= (size - length)) return;
+    const auto spins = loop_while([&]() {
         cachedRemoteRead = remoteRw.data->read;
     }, [&]() { return (localWritten - cachedRemoteRead) > (size - length); }); // block until there is some space
+    if (spins > 0) {
+        counters.add(Stat::SendStalls);
+        counters.add(Stat::WaitSpins, static_cast<uint64_t>(spins));
+    }
 }
 
 void VirtualRingBuffer::send(const uint8_t *data, size_t length) {
@@ -50,6 +54,8 @@ void VirtualRingBuffer::send(const uint8_t *data, size_t length) {
 
     // basically `localRw->written += length;`, but without the mfence or locked instructions
     localRw.data->written.store(localWritten + length, std::memory_order_release);
+    counters.sent(length);
+    counters.set(Stat::RingOccupancy, localWritten + length - cachedRemoteRead);
 }
 
 size_t VirtualRingBuffer::receive(void *whereTo, size_t maxSize) {
@@ -62,6 +68,7 @@ size_t VirtualRingBuffer::receive(void *whereTo, size_t maxSize) {
 
     // basically `localRw->read += maxSize;`, but without the mfence or locked instructions
     localRw.data->read.store(localRead + maxSize, std::memory_order_release);
+    counters.received(maxSize);
     return maxSize;
 }
 
@@ -78,14 +85,28 @@ size_t VirtualRingBuffer::receiveSome(void *whereTo, size_t maxSize) {
 
     // basically `localRw->read += size;`, but without the mfence or locked instructions
     localRw.data->read.store(localRead + size, std::memory_order_release);
+    counters.received(size);
     return size;
 }
 
+bool VirtualRingBuffer::sendAvailable(size_t length) {
+    const auto localWritten = localRw.data->written.load();
+    if ((localWritten - cachedRemoteRead) <= (size - length)) return true;
+    cachedRemoteRead = remoteRw.data->read;
+    return (localWritten - cachedRemoteRead) <= (size - length);
+}
+
+bool VirtualRingBuffer::receiveAvailable(size_t length) const {
+    const auto localRead = localRw.data->read.load();
+    return (remoteRw.data->written - localRead) >= length;
+}
+
 void VirtualRingBuffer::waitUntilReceiveAvailable(size_t maxSize, size_t localRead) {
     size_t remoteWritten;
-    loop_while([&]() {
+    const auto spins = loop_while([&]() {
         remoteWritten = remoteRw.data->written; // probably buffer this in class, so we don't have as much remote reads
     }, [&]() { return (remoteWritten - localRead) < maxSize; }); // block until maxSize is available
+    counters.add(Stat::WaitSpins, static_cast<uint64_t>(spins));
 }
 } // namespace datastructure
 } // namespace l5
@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <memory>
+#include "util/TransportStats.h"
 #include "util/virtualMemory.h"
 
 namespace l5 {
@@ -25,10 +26,12 @@ struct VirtualRingBuffer {
     util::ShmMapping<RingBufferInfo> localRw;
     util::WraparoundBuffer local;
 
-    size_t cachedRemoteRead;
+    size_t cachedRemoteRead = 0;
     util::ShmMapping<RingBufferInfo> remoteRw;
     util::WraparoundBuffer remote;
 
+    util::StatCounters counters{"shared memory"};
+
     /// Establish a shared memory region of size with the remote side of sock
     VirtualRingBuffer(size_t size, const util::Socket &sock);
 
@@ -40,6 +43,14 @@ struct VirtualRingBuffer {
     /// Receive at least 1, up to maxSize bytes
     size_t receiveSome(void* whereTo, size_t maxSize);
 
+    /// Non-blocking check, if length bytes can be sent without waiting for the remote end
+    bool sendAvailable(size_t length);
+
+    /// Non-blocking check, if length bytes can be received without waiting for the remote end
+    bool receiveAvailable(size_t length) const;
+
+    util::TransportStats stats() const { return counters.snapshot(); }
+
 private:
     void waitUntilSendFree(size_t localWritten, size_t length);
 
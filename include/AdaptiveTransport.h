@@ -0,0 +1,346 @@
+#pragma once
+
+#include <memory>
+#include <unistd.h>
+#include "datastructures/VirtualRDMARingBuffer.h"
+#include "datastructures/VirtualRingBuffer.h"
+#include "util/socket/domain.h"
+#include "util/socket/Socket.h"
+#include "util/socket/tcp.h"
+#include "Transport.h"
+
+namespace l5 {
+namespace transport {
+/// The connection types an AdaptiveTransport can upgrade to
+enum class AdaptiveMode : uint8_t {
+   Tcp,
+   SharedMemory,
+   Rdma,
+};
+
+/// Capabilities of one peer, exchanged over the initial TCP connection
+struct AdaptiveHello {
+   /// hostname + boot id, equal iff both peers run on the same (booted) host
+   char hostId[128];
+   bool sharedMemory;
+   bool rdma;
+};
+
+namespace adaptive {
+/// Describe the local host. L5RDMA_ADAPTIVE=rdma (or =tcp) limits the offered connection types, e.g. to use RDMA
+/// between processes on the same host
+AdaptiveHello localHello();
+
+/// Pick the fastest connection type both peers support: shared memory > RDMA > TCP
+AdaptiveMode negotiate(const AdaptiveHello &local, const AdaptiveHello &remote);
+
+/// Domain socket, that a server on the given TCP port uses to exchange the shared memory
+std::string domainSocketPath(uint16_t port);
+
+/// Non-blocking check, if the TCP socket has data available
+bool pollReadable(const util::Socket &sock);
+
+/// Counters of the ring buffer the connection upgraded to, TCP connections are not counted
+inline util::TransportStats stats(const datastructure::VirtualRingBuffer* sharedMemory,
+                                  const datastructure::VirtualRDMARingBuffer* rdma) {
+   if (sharedMemory) return sharedMemory->stats();
+   if (rdma) return rdma->stats();
+   return {};
+}
+} // namespace adaptive
+
+/**
+ * Transport that negotiates the connection type with the remote end over an initial TCP connection: peers on the same
+ * host upgrade to shared memory, peers that both have a usable verbs device upgrade to RDMA, all others stay on TCP.
+ * This makes it possible to use the same binary and configuration everywhere.
+ * @tparam BUFFER_SIZE the buffer size of the upgraded shared memory and RDMA ring buffers
+ */
+template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
+class AdaptiveTransportServer : public TransportServer<AdaptiveTransportServer<BUFFER_SIZE>> {
+   const util::Socket initialSocket;
+   const util::Socket domainSocket;
+   const std::string file;
+   util::Socket communicationSocket;
+   util::Socket sharedMemorySocket;
+   AdaptiveMode mode = AdaptiveMode::Tcp;
+   std::unique_ptr<datastructure::VirtualRingBuffer> sharedMemory;
+   std::unique_ptr<datastructure::VirtualRDMARingBuffer> rdma;
+
+   public:
+   static constexpr auto buffer_size = BUFFER_SIZE;
+
+   explicit AdaptiveTransportServer(const std::string &port);
+
+   ~AdaptiveTransportServer() override;
+
+   /// The connection type of the current connection
+   AdaptiveMode getMode() const { return mode; }
+
+   void accept_impl();
+
+   void write_impl(const uint8_t* data, size_t size);
+
+   void read_impl(uint8_t* buffer, size_t size);
+
+   size_t readSome_impl(uint8_t* buffer, size_t maxSize);
+
+   bool readable_impl(size_t size);
+
+   bool writable_impl(size_t size);
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return adaptive::stats(sharedMemory.get(), rdma.get()); }
+};
+
+template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
+class AdaptiveTransportClient : public TransportClient<AdaptiveTransportClient<BUFFER_SIZE>> {
+   util::Socket socket;
+   util::Socket sharedMemorySocket;
+   AdaptiveMode mode = AdaptiveMode::Tcp;
+   std::unique_ptr<datastructure::VirtualRingBuffer> sharedMemory;
+   std::unique_ptr<datastructure::VirtualRDMARingBuffer> rdma;
+
+   public:
+   static constexpr auto buffer_size = BUFFER_SIZE;
+
+   AdaptiveTransportClient() : socket(util::Socket::create()) {};
+
+   ~AdaptiveTransportClient() override = default;
+
+   /// The connection type of the current connection
+   AdaptiveMode getMode() const { return mode; }
+
+   void connect_impl(const std::string &connection);
+
+   void reset_impl();
+
+   void write_impl(const uint8_t* data, size_t size);
+
+   void read_impl(uint8_t* buffer, size_t size);
+
+   size_t readSome_impl(uint8_t* buffer, size_t maxSize);
+
+   bool readable_impl(size_t size);
+
+   bool writable_impl(size_t size);
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return adaptive::stats(sharedMemory.get(), rdma.get()); }
+};
+
+namespace adaptive {
+template<size_t BUFFER_SIZE>
+void write(AdaptiveMode mode, const util::Socket &sock, datastructure::VirtualRingBuffer* sharedMemory,
+           datastructure::VirtualRDMARingBuffer* rdma, const uint8_t* data, size_t size) {
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         return util::tcp::write(sock, data, size);
+      case AdaptiveMode::SharedMemory:
+         for (size_t i = 0; i < size;) {
+            auto chunk = std::min(size - i, BUFFER_SIZE);
+            sharedMemory->send(&data[i], chunk);
+            i += chunk;
+         }
+         return;
+      case AdaptiveMode::Rdma:
+         for (size_t i = 0; i < size;) {
+            auto chunk = std::min(size - i, BUFFER_SIZE - 2 * sizeof(size_t));
+            rdma->send(&data[i], chunk);
+            i += chunk;
+         }
+         return;
+   }
+}
+
+template<size_t BUFFER_SIZE>
+void read(AdaptiveMode mode, const util::Socket &sock, datastructure::VirtualRingBuffer* sharedMemory,
+          datastructure::VirtualRDMARingBuffer* rdma, uint8_t* buffer, size_t size) {
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         return util::tcp::read(sock, buffer, size);
+      case AdaptiveMode::SharedMemory:
+         for (size_t i = 0; i < size;) {
+            auto chunk = std::min(size - i, BUFFER_SIZE);
+            sharedMemory->receive(&buffer[i], chunk);
+            i += chunk;
+         }
+         return;
+      case AdaptiveMode::Rdma:
+         // the reads don't need to match the writes' messages, partially read messages are continued
+         for (size_t i = 0; i < size;) {
+            i += rdma->receiveSome(&buffer[i], size - i);
+         }
+         return;
+   }
+}
+
+template<size_t BUFFER_SIZE>
+size_t readSome(AdaptiveMode mode, const util::Socket &sock, datastructure::VirtualRingBuffer* sharedMemory,
+                datastructure::VirtualRDMARingBuffer* rdma, uint8_t* buffer, size_t size) {
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         return util::tcp::readSome(sock, buffer, size);
+      case AdaptiveMode::SharedMemory:
+         return sharedMemory->receiveSome(buffer, std::min(size, BUFFER_SIZE));
+      case AdaptiveMode::Rdma:
+         return rdma->receiveSome(buffer, size);
+   }
+   return 0;
+}
+
+template<size_t BUFFER_SIZE>
+bool readable(AdaptiveMode mode, const util::Socket &sock, datastructure::VirtualRingBuffer* sharedMemory,
+              datastructure::VirtualRDMARingBuffer* rdma, size_t size) {
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         return pollReadable(sock);
+      case AdaptiveMode::SharedMemory:
+         return sharedMemory->receiveAvailable(std::min(size, BUFFER_SIZE));
+      case AdaptiveMode::Rdma:
+         return rdma->receiveAvailable();
+   }
+   return false;
+}
+
+template<size_t BUFFER_SIZE>
+bool writable(AdaptiveMode mode, datastructure::VirtualRingBuffer* sharedMemory,
+              datastructure::VirtualRDMARingBuffer* rdma, size_t size) {
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         return true; // the kernel buffers for us
+      case AdaptiveMode::SharedMemory:
+         return sharedMemory->sendAvailable(std::min(size, BUFFER_SIZE));
+      case AdaptiveMode::Rdma:
+         return rdma->sendAvailable(std::min(size, BUFFER_SIZE - 2 * sizeof(size_t)));
+   }
+   return false;
+}
+} // namespace adaptive
+
+template<size_t BUFFER_SIZE>
+AdaptiveTransportServer<BUFFER_SIZE>::AdaptiveTransportServer(const std::string &port) :
+      initialSocket(util::Socket::create()),
+      domainSocket(util::domain::socket()),
+      file(adaptive::domainSocketPath(std::stoi(port))) {
+   util::tcp::bind(initialSocket, std::stoi(port));
+   util::tcp::listen(initialSocket);
+   ::unlink(file.c_str()); // stale socket of a previous server on the same port, if any
+   util::domain::bind(domainSocket, file);
+   util::domain::listen(domainSocket);
+}
+
+template<size_t BUFFER_SIZE>
+AdaptiveTransportServer<BUFFER_SIZE>::~AdaptiveTransportServer() {
+   ::unlink(file.c_str());
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportServer<BUFFER_SIZE>::accept_impl() {
+   sharedMemory.reset();
+   rdma.reset();
+   communicationSocket = util::tcp::accept(initialSocket);
+
+   const auto remote = util::tcp::read<AdaptiveHello>(communicationSocket);
+   mode = adaptive::negotiate(adaptive::localHello(), remote);
+   util::tcp::write(communicationSocket, mode); // the server's decision is binding for both ends
+
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         break;
+      case AdaptiveMode::SharedMemory:
+         sharedMemorySocket = util::domain::accept(domainSocket);
+         sharedMemory = std::make_unique<datastructure::VirtualRingBuffer>(BUFFER_SIZE, sharedMemorySocket);
+         break;
+      case AdaptiveMode::Rdma:
+         rdma = std::make_unique<datastructure::VirtualRDMARingBuffer>(BUFFER_SIZE, communicationSocket);
+         break;
+   }
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportServer<BUFFER_SIZE>::write_impl(const uint8_t* data, size_t size) {
+   adaptive::write<BUFFER_SIZE>(mode, communicationSocket, sharedMemory.get(), rdma.get(), data, size);
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportServer<BUFFER_SIZE>::read_impl(uint8_t* buffer, size_t size) {
+   adaptive::read<BUFFER_SIZE>(mode, communicationSocket, sharedMemory.get(), rdma.get(), buffer, size);
+}
+
+template<size_t BUFFER_SIZE>
+size_t AdaptiveTransportServer<BUFFER_SIZE>::readSome_impl(uint8_t* buffer, size_t maxSize) {
+   return adaptive::readSome<BUFFER_SIZE>(mode, communicationSocket, sharedMemory.get(), rdma.get(), buffer, maxSize);
+}
+
+template<size_t BUFFER_SIZE>
+bool AdaptiveTransportServer<BUFFER_SIZE>::readable_impl(size_t size) {
+   return adaptive::readable<BUFFER_SIZE>(mode, communicationSocket, sharedMemory.get(), rdma.get(), size);
+}
+
+template<size_t BUFFER_SIZE>
+bool AdaptiveTransportServer<BUFFER_SIZE>::writable_impl(size_t size) {
+   return adaptive::writable<BUFFER_SIZE>(mode, sharedMemory.get(), rdma.get(), size);
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportClient<BUFFER_SIZE>::connect_impl(const std::string &connection) {
+   const auto pos = connection.find(':');
+   if (pos == std::string::npos) {
+      throw std::runtime_error("usage: <0.0.0.0:port>");
+   }
+   const auto ip = std::string(connection.data(), pos);
+   const auto port = std::stoi(std::string(connection.begin() + pos + 1, connection.end()));
+
+   util::tcp::connect(socket, ip, port);
+   util::tcp::write(socket, adaptive::localHello());
+   mode = util::tcp::read<AdaptiveMode>(socket);
+
+   switch (mode) {
+      case AdaptiveMode::Tcp:
+         break;
+      case AdaptiveMode::SharedMemory:
+         sharedMemorySocket = util::domain::socket();
+         util::domain::connect(sharedMemorySocket, adaptive::domainSocketPath(port));
+         sharedMemory = std::make_unique<datastructure::VirtualRingBuffer>(BUFFER_SIZE, sharedMemorySocket);
+         break;
+      case AdaptiveMode::Rdma:
+         rdma = std::make_unique<datastructure::VirtualRDMARingBuffer>(BUFFER_SIZE, socket);
+         break;
+   }
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportClient<BUFFER_SIZE>::write_impl(const uint8_t* data, size_t size) {
+   adaptive::write<BUFFER_SIZE>(mode, socket, sharedMemory.get(), rdma.get(), data, size);
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportClient<BUFFER_SIZE>::read_impl(uint8_t* buffer, size_t size) {
+   adaptive::read<BUFFER_SIZE>(mode, socket, sharedMemory.get(), rdma.get(), buffer, size);
+}
+
+template<size_t BUFFER_SIZE>
+size_t AdaptiveTransportClient<BUFFER_SIZE>::readSome_impl(uint8_t* buffer, size_t maxSize) {
+   return adaptive::readSome<BUFFER_SIZE>(mode, socket, sharedMemory.get(), rdma.get(), buffer, maxSize);
+}
+
+template<size_t BUFFER_SIZE>
+bool AdaptiveTransportClient<BUFFER_SIZE>::readable_impl(size_t size) {
+   return adaptive::readable<BUFFER_SIZE>(mode, socket, sharedMemory.get(), rdma.get(), size);
+}
+
+template<size_t BUFFER_SIZE>
+bool AdaptiveTransportClient<BUFFER_SIZE>::writable_impl(size_t size) {
+   return adaptive::writable<BUFFER_SIZE>(mode, sharedMemory.get(), rdma.get(), size);
+}
+
+template<size_t BUFFER_SIZE>
+void AdaptiveTransportClient<BUFFER_SIZE>::reset_impl() {
+   socket = util::Socket::create();
+   sharedMemorySocket = util::Socket();
+   sharedMemory.reset();
+   rdma.reset();
+   mode = AdaptiveMode::Tcp;
+}
+} // namespace transport
+} // namespace l5
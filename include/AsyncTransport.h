@@ -0,0 +1,83 @@
+#pragma once
+
+#include <type_traits>
+#include "util/PollingExecutor.h"
+#include "Transport.h"
+
+namespace l5 {
+namespace transport {
+/**
+ * Awaitable transport operations for coroutines running on a util::PollingExecutor:
+ *    co_await asyncWrite(transport, data, size);
+ *    co_await asyncRead(transport, buffer, size);
+ * The coroutine is parked, until the transport reports (via readable() / writable()), that the operation can complete
+ * without blocking. Requires a transport implementing readable_impl / writable_impl, i.e. one of the ring buffer
+ * transports. Operations larger than the transport's buffer may still block for the remaining chunks.
+ */
+template<class Transport>
+class ReadAwaitable final : public util::Pollable {
+   Transport& transport;
+   uint8_t* whereTo;
+   size_t size;
+
+   public:
+   ReadAwaitable(Transport& transport, uint8_t* whereTo, size_t size) :
+         transport(transport), whereTo(whereTo), size(size) {}
+
+   bool ready() override { return transport.readable(size); }
+
+   bool await_ready() { return ready(); }
+
+   void await_suspend(util::Task::Handle handle) {
+      waiting = handle;
+      handle.promise().executor->park(*this);
+   }
+
+   void await_resume() { transport.read(whereTo, size); }
+};
+
+template<class Transport>
+class WriteAwaitable final : public util::Pollable {
+   Transport& transport;
+   const uint8_t* data;
+   size_t size;
+
+   public:
+   WriteAwaitable(Transport& transport, const uint8_t* data, size_t size) :
+         transport(transport), data(data), size(size) {}
+
+   bool ready() override { return transport.writable(size); }
+
+   bool await_ready() { return ready(); }
+
+   void await_suspend(util::Task::Handle handle) {
+      waiting = handle;
+      handle.promise().executor->park(*this);
+   }
+
+   void await_resume() { transport.write(data, size); }
+};
+
+template<class Transport>
+ReadAwaitable<Transport> asyncRead(Transport& transport, uint8_t* whereTo, size_t size) {
+   return ReadAwaitable<Transport>(transport, whereTo, size);
+}
+
+template<class Transport, typename TriviallyCopyable>
+ReadAwaitable<Transport> asyncRead(Transport& transport, TriviallyCopyable& data) {
+   static_assert(std::is_trivially_copyable_v<TriviallyCopyable>);
+   return ReadAwaitable<Transport>(transport, reinterpret_cast<uint8_t*>(&data), sizeof(data));
+}
+
+template<class Transport>
+WriteAwaitable<Transport> asyncWrite(Transport& transport, const uint8_t* data, size_t size) {
+   return WriteAwaitable<Transport>(transport, data, size);
+}
+
+template<class Transport, typename TriviallyCopyable>
+WriteAwaitable<Transport> asyncWrite(Transport& transport, const TriviallyCopyable& data) {
+   static_assert(std::is_trivially_copyable_v<TriviallyCopyable>);
+   return WriteAwaitable<Transport>(transport, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+}
+} // namespace transport
+} // namespace l5
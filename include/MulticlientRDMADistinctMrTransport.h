@@ -6,6 +6,7 @@
 #include <rdma/Network.hpp>
 #include <rdma/MemoryRegion.h>
 #include <rdma/RcQueuePair.h>
+#include "util/TransportStats.h"
 
 namespace l5::transport {
 class MulticlientRDMADistinctMrTransportServer {
@@ -19,6 +20,8 @@ class MulticlientRDMADistinctMrTransportServer {
         ibv::workrequest::Simple<ibv::workrequest::Write> answerWr;
         /// Send counter to keep track when we need to signal
         size_t sendCounter = 0;
+        /// Statistics of this connection
+        util::StatCounters counters{"multiclient rdma distinct mr server"};
         /// Constructor
         Connection(util::Socket socket, rdma::RcQueuePair qp, ibv::workrequest::Simple<ibv::workrequest::Write> answerWr)
             : socket(std::move(socket)), qp(std::move(qp)), answerWr(answerWr){}
@@ -38,6 +41,8 @@ class MulticlientRDMADistinctMrTransportServer {
     size_t sendCounter = 0;
 
     std::vector<Connection> connections;
+    /// Polls of the receive regions without a message, which can't be attributed to a connection
+    util::StatCounters pollCounters{"multiclient rdma distinct mr server polls"};
 
     void listen(uint16_t port);
 
@@ -67,6 +72,12 @@ public:
 
     void send(size_t receiverId, const uint8_t *data, size_t size);
 
+    /// Counters summed over all connections, all 0 unless built with L5RDMA_STATS
+    util::TransportStats stats() const;
+
+    /// Counters of a single connection
+    util::TransportStats stats(size_t connectionId) const;
+
     template<typename TriviallyCopyable>
     void write(size_t receiverId, const TriviallyCopyable &data) {
         static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
@@ -94,6 +105,8 @@ class MulticlientRDMADistinctMrTransportClient {
 
     ibv::workrequest::Simple<ibv::workrequest::Write> dataWr;
 
+    util::StatCounters counters{"multiclient rdma distinct mr client"};
+
     void rdmaConnect();
 
 public:
@@ -107,6 +120,9 @@ public:
 
     size_t receive(void *whereTo, size_t maxSize);
 
+    /// Counters of this connection, all 0 unless built with L5RDMA_STATS
+    util::TransportStats stats() const { return counters.snapshot(); }
+
     template<typename TriviallyCopyable>
     void write(const TriviallyCopyable &data) {
         static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
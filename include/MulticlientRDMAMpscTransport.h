@@ -0,0 +1,287 @@
+#pragma once
+
+#include "rdma/CompletionQueuePair.hpp"
+#include "rdma/MemoryRegion.h"
+#include "rdma/Network.hpp"
+#include "rdma/RcQueuePair.h"
+#include "util/socket/Socket.h"
+#include "util/TransportStats.h"
+#include "util/virtualMemory.h"
+#include <atomic>
+#include <cstring>
+
+namespace l5::transport {
+namespace mpsc {
+/// Marks the end of a completely written message in the ring
+static constexpr uint64_t validity = 0xDEADDEADBEEFBEEF;
+
+/// Precedes each message in the ring
+struct MessageHeader {
+   uint32_t size;
+   /// Client id, that the server assigned on accept
+   uint32_t sender;
+};
+
+/// The ring's shared positions, on separate cache lines, so the NIC's atomics don't contend with the server's updates
+struct RingPositions {
+   /// Clients reserve space by a remote fetch-and-add
+   alignas(64) uint64_t tail = 0;
+   /// Everything before head was consumed, clients read it for flow control
+   alignas(64) std::atomic<uint64_t> head = 0;
+};
+
+/// header, payload, and the validity, 8 byte aligned
+constexpr size_t messageLength(size_t size) {
+   return sizeof(MessageHeader) + ((size + 7) & ~size_t(7)) + sizeof(validity);
+}
+
+constexpr size_t validityOffset(size_t size) {
+   return messageLength(size) - sizeof(validity);
+}
+} // namespace mpsc
+
+/**
+ * Multi-client transport, in which all clients write into a single ring buffer on the server (multi-producer, single
+ * consumer), instead of a receive buffer and door bell per client. A client reserves space for its message with an
+ * RDMA fetch-and-add on the ring's tail, waits until the server consumed enough (by reading the head), and then writes
+ * the message. The server consumes messages in reservation order, so it never scans, and the server's memory doesn't
+ * grow with the number of clients. A client, which reserved space but never writes, blocks the ring, though.
+ * Answers are written directly into the receive buffer of each client.
+ */
+class MulticlientRDMAMpscTransportServer {
+   /// State for each connection
+   struct Connection {
+      /// Socket from accept (currently unused after bootstrapping)
+      util::Socket socket;
+      /// RDMA Queue Pair
+      rdma::RcQueuePair qp;
+      /// The pre-prepared answer work request. Only the local data source changes for each answer
+      ibv::workrequest::Simple<ibv::workrequest::Write> answerWr;
+      /// Send counter to keep track when we need to signal
+      size_t sendCounter = 0;
+      /// Statistics of this connection
+      util::StatCounters counters{"multiclient rdma mpsc server"};
+      /// Constructor
+      Connection(util::Socket socket, rdma::RcQueuePair qp, ibv::workrequest::Simple<ibv::workrequest::Write> answerWr)
+         : socket(std::move(socket)), qp(std::move(qp)), answerWr(answerWr) {}
+   };
+
+   /// Maximum supported answer size in byte
+   static constexpr size_t MAX_MESSAGESIZE = 256 * 1024;
+   /// The OK byte used to detect partially written answers
+   static constexpr char validity = '\4'; // ASCII EOT char
+   /// How many clients can concurrently connect
+   size_t MAX_CLIENTS;
+   const size_t ringSize;
+   const size_t bitmask;
+
+   util::Socket listenSock;
+   rdma::Network net;
+   rdma::CompletionQueuePair* sharedCq;
+   util::WraparoundBuffer ring;
+   rdma::MemoryRegion ringMr;
+   rdma::RegisteredMemoryRegion<mpsc::RingPositions> positions;
+   rdma::RegisteredMemoryRegion<uint8_t> sendBuffer;
+   std::vector<Connection> connections;
+   /// Polls of the ring without a message, which can't be attributed to a connection
+   util::StatCounters pollCounters{"multiclient rdma mpsc server polls"};
+
+   void listen(uint16_t port);
+
+   template <class T>
+   static constexpr auto setWrFlags(T& wr, bool signaled, bool inlineMsg) {
+      if (signaled && inlineMsg) return wr.setFlags({ibv::workrequest::Flags::SIGNALED, ibv::workrequest::Flags::INLINE});
+      if (signaled) return wr.setFlags({ibv::workrequest::Flags::SIGNALED});
+      if (inlineMsg) return wr.setFlags({ibv::workrequest::Flags::INLINE});
+      return wr.setFlags({});
+   }
+
+   /// The message at the head of the ring, or nullptr if it isn't completely written yet
+   const uint8_t* tryPeek() const {
+      const auto message = &ring.data.get()[positions.underlying[0].head.load(std::memory_order_relaxed) & bitmask];
+      const auto size = *reinterpret_cast<const volatile uint32_t*>(message);
+      if (mpsc::messageLength(size) > ringSize) {
+         return nullptr; // size not yet completely written
+      }
+      const auto checkMe = *reinterpret_cast<const volatile uint64_t*>(message + mpsc::validityOffset(size));
+      return checkMe == mpsc::validity ? message : nullptr;
+   }
+
+   /// Hand the message to the callback, and release its space in the ring. The space is also released, when the
+   /// message is invalid or the callback throws, otherwise a single bad message would block the ring for all clients
+   template <typename RangeConsumer>
+   void consume(const uint8_t* message, RangeConsumer&& callback) {
+      auto header = mpsc::MessageHeader{};
+      std::memcpy(&header, message, sizeof(header));
+      try {
+         // the only index, that a client can choose freely
+         if (header.sender >= connections.size()) {
+            throw std::runtime_error("message from an unknown client");
+         }
+         const auto begin = message + sizeof(header);
+         callback(size_t(header.sender), begin, begin + header.size);
+      } catch (...) {
+         release(message, header.size);
+         throw;
+      }
+      release(message, header.size);
+      connections[header.sender].counters.received(header.size);
+   }
+
+   void release(const uint8_t* message, uint32_t size) {
+      const auto start = const_cast<uint8_t*>(message);
+      std::fill(start, start + mpsc::messageLength(size), 0);
+      auto& head = positions.underlying[0].head;
+      head.store(head.load(std::memory_order_relaxed) + mpsc::messageLength(size), std::memory_order_release);
+   }
+
+   public:
+   /// ringSize needs to be a power of 2
+   explicit MulticlientRDMAMpscTransportServer(const std::string& port, size_t maxClients = 256,
+                                               size_t ringSize = 16 * 1024 * 1024);
+
+   ~MulticlientRDMAMpscTransportServer() = default;
+
+   void accept();
+
+   void finishListen();
+
+   /// waits for the next message in the ring and copys it to "whereTo"
+   size_t receive(void* whereTo, size_t maxSize);
+
+   void send(size_t receiverId, const uint8_t* data, size_t size);
+
+   /// Counters summed over all connections, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const;
+
+   /// Counters of a single connection
+   util::TransportStats stats(size_t connectionId) const;
+
+   /// receive data via a lambda to enable zerocopy operation
+   /// expected signature: [](size_t sender, const uint8_t* begin, const uint8_t* end) -> void
+   template <typename RangeConsumer>
+   void receive(RangeConsumer&& callback) {
+      const uint8_t* message;
+      uint64_t spins = 0;
+      while ((message = tryPeek()) == nullptr) ++spins;
+      pollCounters.add(util::Stat::WaitSpins, spins);
+      consume(message, std::forward<RangeConsumer>(callback));
+   }
+
+   /// non-blocking variant of receive(callback), returns false, if there is no complete message
+   template <typename RangeConsumer>
+   bool tryReceive(RangeConsumer&& callback) {
+      const auto message = tryPeek();
+      if (message == nullptr) {
+         pollCounters.add(util::Stat::WaitSpins);
+         return false;
+      }
+      consume(message, std::forward<RangeConsumer>(callback));
+      return true;
+   }
+
+   template <typename TriviallyCopyable>
+   void write(size_t receiverId, const TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      send(receiverId, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+   }
+
+   template <typename TriviallyCopyable>
+   size_t read(TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      return receive(reinterpret_cast<uint8_t*>(&data), sizeof(data));
+   }
+};
+
+class MulticlientRDMAMpscTransportClient {
+   static constexpr size_t MAX_MESSAGESIZE = 256 * 1024;
+   static constexpr char validity = '\4'; // ASCII EOT char
+
+   util::Socket sock;
+   rdma::Network net;
+   rdma::CompletionQueuePair& cq;
+   rdma::RcQueuePair qp;
+
+   rdma::RegisteredMemoryRegion<uint8_t> sendBuffer;
+   rdma::RegisteredMemoryRegion<uint8_t> receiveBuffer;
+   /// Results of the fetch-and-add on the tail [0] and reads of the head [1]
+   rdma::RegisteredMemoryRegion<uint64_t> positions;
+
+   ibv::memoryregion::RemoteAddress ringAddr{};
+   ibv::memoryregion::RemoteAddress tailAddr{};
+   ibv::memoryregion::RemoteAddress headAddr{};
+   uint64_t ringSize = 0;
+   /// Assigned by the server, identifies our messages
+   uint32_t clientId = 0;
+   /// The server's head, as last read
+   uint64_t knownHead = 0;
+
+   util::StatCounters counters{"multiclient rdma mpsc client"};
+
+   void rdmaConnect();
+
+   /// Returns the start of the reserved space in the ring
+   uint64_t reserve(size_t length);
+
+   /// Wait until the server consumed enough messages, that [start, start + length) is free
+   void waitUntilFree(uint64_t start, size_t length);
+
+   public:
+   MulticlientRDMAMpscTransportClient();
+
+   void connect(std::string_view whereTo);
+
+   void connect(const std::string& ip, uint16_t port);
+
+   void send(const uint8_t* data, size_t size);
+
+   size_t receive(void* whereTo, size_t maxSize);
+
+   /// Counters of this connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return counters.snapshot(); }
+
+   /// receive data via a lambda to enable zerocopy operation
+   /// expected signature: [](const uint8_t* begin, const uint8_t* end) -> void
+   template <typename RangeConsumer>
+   void receive(RangeConsumer&& callback) {
+      size_t size;
+      uint64_t spins = 0;
+      while ((size = *reinterpret_cast<volatile size_t*>(receiveBuffer.data())) == 0) ++spins;
+      while (*reinterpret_cast<volatile char*>(receiveBuffer.data() + sizeof(size_t) + size) != validity) ++spins;
+
+      const auto begin = receiveBuffer.data() + sizeof(size_t);
+      callback(begin, begin + size);
+      *reinterpret_cast<volatile size_t*>(receiveBuffer.data()) = 0;
+      counters.add(util::Stat::WaitSpins, spins);
+      counters.received(size);
+   }
+
+   /// non-blocking variant of receive(callback). Returns false, if no complete answer has arrived yet
+   template <typename RangeConsumer>
+   bool tryReceive(RangeConsumer&& callback) {
+      const auto size = *reinterpret_cast<volatile size_t*>(receiveBuffer.data());
+      if (size == 0 || *reinterpret_cast<volatile char*>(receiveBuffer.data() + sizeof(size_t) + size) != validity) {
+         counters.add(util::Stat::WaitSpins);
+         return false;
+      }
+
+      const auto begin = receiveBuffer.data() + sizeof(size_t);
+      callback(begin, begin + size);
+      *reinterpret_cast<volatile size_t*>(receiveBuffer.data()) = 0;
+      counters.received(size);
+      return true;
+   }
+
+   template <typename TriviallyCopyable>
+   void write(const TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      send(reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+   }
+
+   template <typename TriviallyCopyable>
+   void read(TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      receive(reinterpret_cast<uint8_t*>(&data), sizeof(data));
+   }
+};
+} // namespace l5::transport
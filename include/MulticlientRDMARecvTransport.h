@@ -5,6 +5,7 @@
 #include "rdma/Network.hpp"
 #include "rdma/RcQueuePair.h"
 #include "util/socket/Socket.h"
+#include "util/TransportStats.h"
 #include <unordered_map>
 #include <emmintrin.h>
 
@@ -22,6 +23,8 @@ class MulticlientRDMARecvTransportServer {
       ibv::workrequest::Recv recv;
       /// Send counter to keep track when we need to signal
       size_t sendCounter = 0; // TODO: instead of a send counter, maybe use an "unsignaled" count with a threshold
+      /// Statistics of this connection
+      util::StatCounters counters{"multiclient rdma recv server"};
       /// Constructor
       Connection(util::Socket socket, rdma::RcQueuePair qp, ibv::workrequest::Simple<ibv::workrequest::Write> answerWr,
                  ibv::workrequest::Recv recv)
@@ -42,6 +45,8 @@ class MulticlientRDMARecvTransportServer {
    rdma::RegisteredMemoryRegion<uint8_t> sendBuffer;
    std::vector<Connection> connections;
    std::unordered_map<uint32_t, uint32_t> qpnToConnection;
+   /// Empty polls of the shared receive queue, which can't be attributed to a connection
+   util::StatCounters pollCounters{"multiclient rdma recv server polls"};
 
    void listen(uint16_t port);
 
@@ -71,6 +76,12 @@ class MulticlientRDMARecvTransportServer {
 
    void send(size_t receiverId, const uint8_t* data, size_t size);
 
+   /// Counters summed over all connections, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const;
+
+   /// Counters of a single connection
+   util::TransportStats stats(size_t connectionId) const;
+
    template <typename TriviallyCopyable>
    void write(size_t receiverId, const TriviallyCopyable& data) {
       static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
@@ -99,6 +110,8 @@ class MulticlientRDMARecvTransportClient {
    /// Write with immediate, consumes a RECV on the server so we can poll using a shared completion queue
    ibv::workrequest::Simple<ibv::workrequest::WriteWithImm> dataWr;
 
+   util::StatCounters counters{"multiclient rdma recv client"};
+
    void rdmaConnect();
 
    public:
@@ -112,6 +125,9 @@ class MulticlientRDMARecvTransportClient {
 
    size_t receive(void* whereTo, size_t maxSize);
 
+   /// Counters of this connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return counters.snapshot(); }
+
    template <typename TriviallyCopyable>
    void write(const TriviallyCopyable& data) {
       static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
@@ -6,6 +6,8 @@
 #include <rdma/Network.hpp>
 #include <rdma/MemoryRegion.h>
 #include <rdma/RcQueuePair.h>
+#include "util/Tracepoints.h"
+#include "util/TransportStats.h"
 
 namespace l5 {
 namespace transport {
@@ -20,6 +22,8 @@ class MulticlientRDMATransportServer {
         ibv::workrequest::Simple<ibv::workrequest::Write> answerWr;
         /// Send counter to keep track when we need to signal
         size_t sendCounter = 0;
+        /// Statistics of this connection
+        util::StatCounters counters{"multiclient rdma server"};
         /// Constructor
         Connection(util::Socket socket, rdma::RcQueuePair qp, ibv::workrequest::Simple<ibv::workrequest::Write> answerWr)
             : socket(std::move(socket)), qp(std::move(qp)), answerWr(answerWr){}
@@ -41,6 +45,8 @@ class MulticlientRDMATransportServer {
     size_t sendCounter = 0;
 
     std::vector<Connection> connections;
+    /// Door bell polls without a message, which can't be attributed to a connection
+    util::StatCounters pollCounters{"multiclient rdma server polls"};
 
     void listen(uint16_t port);
 
@@ -56,21 +62,32 @@ class MulticlientRDMATransportServer {
         }
     }
 
+    /// one pass over all door bells. Returns count, if no door bell was rung
     __always_inline
-    static size_t pollSSE(char *doorBells, size_t count) noexcept {
+    static size_t tryPollSSE(char *doorBells, size_t count) noexcept {
         const auto zero = _mm_set1_epi8('\0');
+        for (size_t i = 0; i < count; i += 16) {
+            auto data = *reinterpret_cast<volatile __m128i *>(&doorBells[i]);
+            auto cmp = _mm_cmpeq_epi8(zero, data);
+            uint16_t cmpMask = compl _mm_movemask_epi8(cmp);
+            if (cmpMask != 0) {
+                auto lzcnt = __builtin_clz(cmpMask);
+                auto sender = 32 - (lzcnt + 1) + i;
+                doorBells[sender] = '\0';
+                return sender;
+            }
+        }
+        return count;
+    }
+
+    __always_inline
+    static size_t pollSSE(char *doorBells, size_t count, util::StatCounters &counters) noexcept {
         for (;;) {
-            for (size_t i = 0; i < count; i += 16) {
-                auto data = *reinterpret_cast<volatile __m128i *>(&doorBells[i]);
-                auto cmp = _mm_cmpeq_epi8(zero, data);
-                uint16_t cmpMask = compl _mm_movemask_epi8(cmp);
-                if (cmpMask != 0) {
-                    auto lzcnt = __builtin_clz(cmpMask);
-                    auto sender = 32 - (lzcnt + 1) + i;
-                    doorBells[sender] = '\0';
-                    return sender;
-                }
+            const auto sender = tryPollSSE(doorBells, count);
+            if (sender != count) {
+                return sender;
             }
+            counters.add(util::Stat::WaitSpins);
         }
     }
 
@@ -100,11 +117,17 @@ public:
 
     void send(size_t receiverId, const uint8_t *data, size_t size);
 
+    /// Counters summed over all connections, all 0 unless built with L5RDMA_STATS
+    util::TransportStats stats() const;
+
+    /// Counters of a single connection
+    util::TransportStats stats(size_t connectionId) const;
+
     /// send data via a lambda to enable zerocopy operation
     /// expected signature: [](uint8_t* begin) -> size_t
     template<typename SizeReturner>
     void send(size_t receiverId, SizeReturner &&doWork) {
-        if (receiverId > connections.size()) {
+        if (receiverId >= connections.size()) {
             throw std::runtime_error("no such connection");
         }
 
@@ -125,23 +148,51 @@ public:
         *validityPtr = validity;
 
         con.answerWr.setLocalAddress(sendBuffer.getSlice(0, totalLength));
-        // selective signaling needs to happen per queuepair / connection
+        const auto inlineMsg = totalLength <= con.qp.getMaxInlineSize();
+        if (inlineMsg) {
+            con.counters.add(util::Stat::InlinedWrs);
+        }
+        // selective signaling needs to happen per queuepair / connection. The send buffer is reused by the next
+        // answer right away, so also wait for answers, that aren't inlined, until the NIC read them
         ++con.sendCounter;
-        if (con.sendCounter % 1024 == 0) { // selective signaling
-            setWrFlags(con.answerWr, true, totalLength < 512);
+        if (con.sendCounter % 1024 == 0 || not inlineMsg) {
+            setWrFlags(con.answerWr, true, inlineMsg);
             con.qp.postWorkRequest(con.answerWr);
-            sharedCq->pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
+            const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+            while (con.counters.poll(sharedCq->pollSendCompletionQueue(opcode)) == util::StatCounters::noCompletion);
         } else {
-            setWrFlags(con.answerWr, false, totalLength < 512);
+            setWrFlags(con.answerWr, false, inlineMsg);
             con.qp.postWorkRequest(con.answerWr);
         }
+        con.counters.sent(size);
     }
 
     /// receive data via a lambda to enable zerocopy operation
     /// expected signature: [](size_t sender, const uint8_t* begin, const uint8_t* end) -> void
     template<typename RangeConsumer>
     void receive(RangeConsumer &&callback) {
-        const auto sender = pollSSE(doorBells.data(), MAX_CLIENTS);
+        L5_TRACE(multiclient_poll_begin, MAX_CLIENTS);
+        const auto sender = pollSSE(doorBells.data(), MAX_CLIENTS, pollCounters);
+        L5_TRACE(multiclient_poll_end, sender);
+
+        const auto sizePtr = reinterpret_cast<uint8_t *>(receives.data()[sender]);
+        const auto size = *reinterpret_cast<size_t *>(sizePtr);
+
+        const auto begin = sizePtr + sizeof(size_t);
+        const auto end = begin + size;
+        callback(sender, begin, end);
+        connections[sender].counters.received(size);
+    }
+
+    /// non-blocking variant of receive(callback), for batching requests of multiple clients
+    /// returns false, if no client has sent a message
+    template<typename RangeConsumer>
+    bool tryReceive(RangeConsumer &&callback) {
+        const auto sender = tryPollSSE(doorBells.data(), MAX_CLIENTS);
+        if (sender == MAX_CLIENTS) {
+            pollCounters.add(util::Stat::WaitSpins);
+            return false;
+        }
 
         const auto sizePtr = reinterpret_cast<uint8_t *>(receives.data()[sender]);
         const auto size = *reinterpret_cast<size_t *>(sizePtr);
@@ -149,6 +200,8 @@ public:
         const auto begin = sizePtr + sizeof(size_t);
         const auto end = begin + size;
         callback(sender, begin, end);
+        connections[sender].counters.received(size);
+        return true;
     }
 
     template<typename TriviallyCopyable>
@@ -180,6 +233,8 @@ class MultiClientRDMATransportClient {
     ibv::workrequest::Simple<ibv::workrequest::Write> dataWr;
     ibv::workrequest::Simple<ibv::workrequest::Write> doorBellWr;
 
+    util::StatCounters counters{"multiclient rdma client"};
+
     void rdmaConnect();
 
 public:
@@ -193,6 +248,9 @@ public:
 
     size_t receive(void *whereTo, size_t maxSize);
 
+    /// Counters of this connection, all 0 unless built with L5RDMA_STATS
+    util::TransportStats stats() const { return counters.snapshot(); }
+
     /// send data via a lambda to enable zerocopy operation
     /// expected signature: [](uint8_t* begin) -> size_t
     template<typename SizeReturner>
@@ -213,9 +271,12 @@ public:
 
         doorBell.data()[0] = 'X'; // could be anything, really
         qp.postWorkRequest(doorBellWr);
+        counters.add(util::Stat::InlinedWrs, 2);
 
-        cq.pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
-        cq.pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
+        const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+        while (counters.poll(cq.pollSendCompletionQueue(opcode)) == util::StatCounters::noCompletion);
+        while (counters.poll(cq.pollSendCompletionQueue(opcode)) == util::StatCounters::noCompletion);
+        counters.sent(size);
     }
 
     /// receive data via a lambda to enable zerocopy operation
@@ -223,14 +284,35 @@ public:
     template<typename RangeConsumer>
     void receive(RangeConsumer &&callback) {
         size_t size;
-        while ((size = *reinterpret_cast<volatile size_t *>(receiveBuffer.data())) == 0);
-        while (*reinterpret_cast<volatile char *>(receiveBuffer.data() + sizeof(size_t) + size) != validity);
+        uint64_t spins = 0;
+        while ((size = *reinterpret_cast<volatile size_t *>(receiveBuffer.data())) == 0) ++spins;
+        while (*reinterpret_cast<volatile char *>(receiveBuffer.data() + sizeof(size_t) + size) != validity) ++spins;
+
+        const auto begin = receiveBuffer.data() + sizeof(size_t);
+        const auto end = begin + size;
+
+        callback(begin, end);
+        *reinterpret_cast<volatile size_t *>(receiveBuffer.data()) = 0;
+        counters.add(util::Stat::WaitSpins, spins);
+        counters.received(size);
+    }
+
+    /// non-blocking variant of receive(callback). Returns false, if no complete answer has arrived yet
+    template<typename RangeConsumer>
+    bool tryReceive(RangeConsumer &&callback) {
+        const auto size = *reinterpret_cast<volatile size_t *>(receiveBuffer.data());
+        if (size == 0 || *reinterpret_cast<volatile char *>(receiveBuffer.data() + sizeof(size_t) + size) != validity) {
+            counters.add(util::Stat::WaitSpins);
+            return false;
+        }
 
         const auto begin = receiveBuffer.data() + sizeof(size_t);
         const auto end = begin + size;
 
         callback(begin, end);
         *reinterpret_cast<volatile size_t *>(receiveBuffer.data()) = 0;
+        counters.received(size);
+        return true;
     }
 
     template<typename TriviallyCopyable>
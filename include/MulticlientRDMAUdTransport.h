@@ -0,0 +1,192 @@
+#pragma once
+
+#include "rdma/CompletionQueuePair.hpp"
+#include "rdma/MemoryRegion.h"
+#include "rdma/Network.hpp"
+#include "rdma/UdQueuePair.h"
+#include "util/socket/Socket.h"
+#include "util/TransportStats.h"
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace l5::transport {
+namespace ud {
+/// Smallest MTU, that InfiniBand supports. Datagrams are as large as the active MTU of both ports allows
+static constexpr size_t MIN_MTU = 256;
+/// Receive buffers of UD queue pairs always start with room for the global routing header, see `man ibv_post_recv`
+static constexpr size_t GRH_SIZE = 40;
+/// Maximum supported message size in byte
+static constexpr size_t MAX_MESSAGESIZE = 256 * 1024;
+/// Upper bound for the posted receives of the server, below the capacity of the shared receive queue
+static constexpr size_t MAX_RECEIVES = 16'000;
+/// The queue key, that rdma::UdQueuePair sets up
+static constexpr uint32_t QKEY = 0x22222222;
+
+/// Precedes each datagram. Messages larger than the MTU are split into several datagrams
+struct SegmentHeader {
+   /// Client id, that the server assigned on connect
+   uint32_t sender;
+   /// Size of the whole message
+   uint32_t messageSize;
+   /// Where this segment's payload goes in the message
+   uint32_t offset;
+};
+
+constexpr size_t receiveSlotSize(size_t mtu) { return GRH_SIZE + mtu; }
+
+constexpr size_t segmentPayload(size_t mtu) { return mtu - sizeof(SegmentHeader); }
+
+constexpr size_t maxSegments(size_t mtu) { return (MAX_MESSAGESIZE + segmentPayload(mtu) - 1) / segmentPayload(mtu); }
+
+/// Holds the datagrams of one message, for any MTU
+static constexpr size_t SEND_BUFFER_SIZE = maxSegments(MIN_MTU) * MIN_MTU;
+
+/// A message that arrives in several segments
+struct Reassembly {
+   std::vector<uint8_t> data;
+   size_t received = 0;
+
+   /// Adds a segment and copies the message to whereTo once it is complete, returning its size.
+   /// Datagrams are unreliable: a gap in the offsets means a segment was dropped, and the message is discarded
+   std::optional<size_t> add(const SegmentHeader& header, const uint8_t* payload, size_t length, uint8_t* whereTo);
+};
+} // namespace ud
+
+/**
+ * Multi-client transport over a single unreliable datagram (UD) queue pair on the server. Other than the RC based
+ * multi-client transports, the server needs no queue pair, door bell, or receive buffer per client, only an address
+ * handle, so it scales to 10k+ clients. The clients' messages share a pool of receive buffers on the shared receive
+ * queue, which is sized with maxClients. TCP is only used to exchange addresses on accept, so the server doesn't keep
+ * a file descriptor per client either.
+ * Like UD itself, this transport is unreliable: messages are lost, when the server runs out of posted receives.
+ */
+class MulticlientRDMAUdTransportServer {
+   /// State for each client
+   struct Connection {
+      /// Destination of answers
+      std::unique_ptr<ibv::ah::AddressHandle> addressHandle;
+      uint32_t qpn;
+      /// Largest datagram towards this client, the smaller active MTU of both ports
+      size_t mtu;
+      /// Partially received message of this client (only allocated for messages larger than one datagram)
+      ud::Reassembly pending;
+      /// Statistics of this connection
+      util::StatCounters counters{"multiclient rdma ud server"};
+
+      Connection(std::unique_ptr<ibv::ah::AddressHandle> addressHandle, uint32_t qpn, size_t mtu)
+         : addressHandle(std::move(addressHandle)), qpn(qpn), mtu(mtu) {}
+   };
+
+   /// How many clients can concurrently connect
+   size_t MAX_CLIENTS;
+
+   util::Socket listenSock;
+   rdma::Network net;
+   /// Active MTU of our port, clients never send larger datagrams
+   size_t mtu;
+   /// Posted receives, shared by all clients
+   size_t receiveSlots;
+   rdma::CompletionQueuePair* sharedCq;
+   rdma::UdQueuePair qp;
+   rdma::RegisteredMemoryRegion<uint8_t> receiveBuffer;
+   rdma::RegisteredMemoryRegion<uint8_t> sendBuffer;
+   ibv::workrequest::Simple<ibv::workrequest::Send> answerWr;
+   /// Posted, but not yet signaled work requests
+   size_t unsignaled = 0;
+   std::vector<Connection> connections;
+   /// Empty polls and invalid datagrams, which can't be attributed to a connection
+   util::StatCounters pollCounters{"multiclient rdma ud server polls"};
+
+   void listen(uint16_t port);
+
+   void postReceive(size_t slot);
+
+   public:
+   explicit MulticlientRDMAUdTransportServer(const std::string& port, size_t maxClients = 256);
+
+   ~MulticlientRDMAUdTransportServer() = default;
+
+   MulticlientRDMAUdTransportServer(MulticlientRDMAUdTransportServer&&) = default;
+
+   MulticlientRDMAUdTransportServer& operator=(MulticlientRDMAUdTransportServer&&) = default;
+
+   void accept();
+
+   void finishListen();
+
+   /// polls the receive queue until a message of any client is complete and copys it to "whereTo"
+   size_t receive(void* whereTo, size_t maxSize);
+
+   void send(size_t receiverId, const uint8_t* data, size_t size);
+
+   /// Counters summed over all connections, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const;
+
+   /// Counters of a single connection
+   util::TransportStats stats(size_t connectionId) const;
+
+   template <typename TriviallyCopyable>
+   void write(size_t receiverId, const TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      send(receiverId, reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+   }
+
+   template <typename TriviallyCopyable>
+   size_t read(TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      return receive(reinterpret_cast<uint8_t*>(&data), sizeof(data));
+   }
+};
+
+class MulticlientRDMAUdTransportClient {
+   rdma::Network net;
+   rdma::CompletionQueuePair& cq;
+   rdma::UdQueuePair qp;
+
+   rdma::RegisteredMemoryRegion<uint8_t> sendBuffer;
+   /// Largest datagram in both directions, the smaller active MTU of both ports, known after connect
+   size_t mtu = 0;
+   /// Enough posted receives for two maximum sized answers, allocated on connect, when the MTU is known
+   size_t receiveSlots = 0;
+   std::optional<rdma::RegisteredMemoryRegion<uint8_t>> receiveBuffer;
+
+   std::unique_ptr<ibv::ah::AddressHandle> serverAddressHandle;
+   ibv::workrequest::Simple<ibv::workrequest::Send> dataWr;
+   /// Assigned by the server, identifies our messages
+   uint32_t clientId = 0;
+   uint32_t serverQpn = 0;
+   size_t unsignaled = 0;
+   ud::Reassembly pending;
+
+   util::StatCounters counters{"multiclient rdma ud client"};
+
+   void postReceive(size_t slot);
+
+   public:
+   MulticlientRDMAUdTransportClient();
+
+   void connect(std::string_view whereTo);
+
+   void connect(const std::string& ip, uint16_t port);
+
+   void send(const uint8_t* data, size_t size);
+
+   size_t receive(void* whereTo, size_t maxSize);
+
+   /// Counters of this connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return counters.snapshot(); }
+
+   template <typename TriviallyCopyable>
+   void write(const TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      send(reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+   }
+
+   template <typename TriviallyCopyable>
+   void read(TriviallyCopyable& data) {
+      static_assert(std::is_trivially_copyable<TriviallyCopyable>::value, "");
+      receive(reinterpret_cast<uint8_t*>(&data), sizeof(data));
+   }
+};
+} // namespace l5::transport
@@ -5,6 +5,7 @@
 #include <vector>
 #include <poll.h>
 #include "util/socket/Socket.h"
+#include "util/TransportStats.h"
 
 namespace l5 {
 namespace transport {
@@ -12,6 +13,8 @@ class MulticlientTCPTransportServer {
     const util::Socket serverSocket;
     std::vector<util::Socket> connections;
     std::vector<pollfd> pollFds;
+    /// Statistics, one per connection
+    std::vector<util::StatCounters> counters;
 
     void listen(uint16_t port);
 
@@ -26,6 +29,12 @@ public:
 
     void send(size_t receiverId, const uint8_t *data, size_t size);
 
+    /// Counters summed over all connections, all 0 unless built with L5RDMA_STATS
+    util::TransportStats stats() const;
+
+    /// Counters of a single connection
+    util::TransportStats stats(size_t connectionId) const;
+
     template<typename TriviallyCopyable>
     void write(size_t receiverId, const TriviallyCopyable &data) {
         static_assert(std::is_trivially_copyable_v<TriviallyCopyable>);
@@ -41,6 +50,7 @@ public:
 
 class MulticlientTCPTransportClient {
     util::Socket socket;
+    util::StatCounters counters{"multiclient tcp client"};
 public:
     MulticlientTCPTransportClient();
 
@@ -58,6 +68,9 @@ public:
 
     void receive(void *whereTo, size_t maxSize);
 
+    /// Counters of this connection, all 0 unless built with L5RDMA_STATS
+    util::TransportStats stats() const { return counters.snapshot(); }
+
     template<typename TriviallyCopyable>
     void write(const TriviallyCopyable &data) {
         static_assert(std::is_trivially_copyable_v<TriviallyCopyable>);
@@ -8,15 +8,21 @@
 
 namespace l5 {
 namespace transport {
-template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
-class RdmaTransportServer : public TransportServer<RdmaTransportServer<BUFFER_SIZE>> {
+template<size_t BUFFER_SIZE = 16 * 1024 * 1024, typename QueuePair = rdma::RcQueuePair>
+class RdmaTransportServer : public TransportServer<RdmaTransportServer<BUFFER_SIZE, QueuePair>> {
    const util::Socket sock;
-   std::unique_ptr<datastructure::VirtualRDMARingBuffer> rdma = nullptr;
+   std::unique_ptr<datastructure::BasicVirtualRDMARingBuffer<QueuePair>> rdma = nullptr;
 
    void listen(uint16_t port);
 
    public:
    static constexpr auto buffer_size = BUFFER_SIZE;
+   /// Larger writes are streamed in pieces of this size, so the receiver can drain the ring while it's still filled
+   static constexpr auto chunk_size = BUFFER_SIZE / 4;
+   /// Reliable connections don't copy writes of at least this size from a buffer added with registerBuffer through
+   /// the ring, but let the receiver read them straight into its destination (see
+   /// BasicVirtualRDMARingBuffer::sendRendezvous)
+   static constexpr size_t rendezvous_threshold = 1024 * 1024;
 
    explicit RdmaTransportServer(const std::string &port);
 
@@ -35,19 +41,50 @@ class RdmaTransportServer : public TransportServer<RdmaTransportServer<BUFFER_SI
 
    size_t readSome_impl(uint8_t *buffer, size_t maxSize);
 
+   bool readable_impl(size_t size);
+
+   bool writable_impl(size_t size);
+
    template<typename SizeReturner>
    void writeZC(SizeReturner &&doWork) {
       rdma->send(std::forward<SizeReturner>(doWork));
    }
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return rdma ? rdma->stats() : util::TransportStats{}; }
+
+   /// Keep a buffer, that is used for large reads or writes over and over, registered for the current connection,
+   /// instead of registering it for every transfer. It needs to be unregistered, before it's unmapped.
+   /// Writes of at least rendezvous_threshold byte from it aren't copied through the ring, but block until the
+   /// remote end read them, so both ends can't write such messages before reading. writable() doesn't know about that
+   void registerBuffer(const void* addr, size_t length) {
+      if (not rdma) {
+         throw std::runtime_error("buffers can only be registered for a connection, i.e. after accept()");
+      }
+      rdma->registrations().add(addr, length);
+   }
+
+   /// Registrations end with their connection, so without one, there is nothing to unregister
+   void unregisterBuffer(const void* addr) {
+      if (rdma) {
+         rdma->registrations().remove(addr);
+      }
+   }
 };
 
-template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
-class RdmaTransportClient : public TransportClient<RdmaTransportClient<BUFFER_SIZE>> {
+template<size_t BUFFER_SIZE = 16 * 1024 * 1024, typename QueuePair = rdma::RcQueuePair>
+class RdmaTransportClient : public TransportClient<RdmaTransportClient<BUFFER_SIZE, QueuePair>> {
    util::Socket sock;
-   std::unique_ptr<datastructure::VirtualRDMARingBuffer> rdma = nullptr;
+   std::unique_ptr<datastructure::BasicVirtualRDMARingBuffer<QueuePair>> rdma = nullptr;
 
    public:
    static constexpr auto buffer_size = BUFFER_SIZE;
+   /// Larger writes are streamed in pieces of this size, so the receiver can drain the ring while it's still filled
+   static constexpr auto chunk_size = BUFFER_SIZE / 4;
+   /// Reliable connections don't copy writes of at least this size from a buffer added with registerBuffer through
+   /// the ring, but let the receiver read them straight into its destination (see
+   /// BasicVirtualRDMARingBuffer::sendRendezvous)
+   static constexpr size_t rendezvous_threshold = 1024 * 1024;
 
    RdmaTransportClient() : sock(util::Socket::create()) {};
 
@@ -72,57 +109,104 @@ class RdmaTransportClient : public TransportClient<RdmaTransportClient<BUFFER_SI
 
     size_t readSome_impl(uint8_t *buffer, size_t maxSize);
 
+   bool readable_impl(size_t size);
+
+   bool writable_impl(size_t size);
+
    template<typename SizeReturner>
    void writeZC(SizeReturner &&doWork) {
       rdma->send(std::forward<SizeReturner>(doWork));
    }
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return rdma ? rdma->stats() : util::TransportStats{}; }
+
+   /// Keep a buffer, that is used for large reads or writes over and over, registered for the current connection,
+   /// instead of registering it for every transfer. It needs to be unregistered, before it's unmapped.
+   /// Writes of at least rendezvous_threshold byte from it aren't copied through the ring, but block until the
+   /// remote end read them, so both ends can't write such messages before reading. writable() doesn't know about that
+   void registerBuffer(const void* addr, size_t length) {
+      if (not rdma) {
+         throw std::runtime_error("buffers can only be registered for a connection, i.e. after connect()");
+      }
+      rdma->registrations().add(addr, length);
+   }
+
+   /// Registrations end with their connection, so without one, there is nothing to unregister
+   void unregisterBuffer(const void* addr) {
+      if (rdma) {
+         rdma->registrations().remove(addr);
+      }
+   }
 };
 
-template<size_t BUFFER_SIZE>
-RdmaTransportServer<BUFFER_SIZE>::RdmaTransportServer(const std::string &port) :
+/// Over an unreliable connection without ACK traffic, messages may get lost (see BasicVirtualRDMARingBuffer)
+template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
+using UnreliableRdmaTransportServer = RdmaTransportServer<BUFFER_SIZE, rdma::UcQueuePair>;
+
+template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
+using UnreliableRdmaTransportClient = RdmaTransportClient<BUFFER_SIZE, rdma::UcQueuePair>;
+
+template<size_t BUFFER_SIZE, typename QueuePair>
+RdmaTransportServer<BUFFER_SIZE, QueuePair>::RdmaTransportServer(const std::string &port) :
       sock(util::Socket::create()) {
    auto p = std::stoi(port);
    listen(p);
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportServer<BUFFER_SIZE>::accept_impl() {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportServer<BUFFER_SIZE, QueuePair>::accept_impl() {
    auto acced = util::tcp::accept(sock);
-   rdma = std::make_unique<datastructure::VirtualRDMARingBuffer>(BUFFER_SIZE, acced);
+   rdma = std::make_unique<datastructure::BasicVirtualRDMARingBuffer<QueuePair>>(BUFFER_SIZE, acced);
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportServer<BUFFER_SIZE>::listen(uint16_t port) {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportServer<BUFFER_SIZE, QueuePair>::listen(uint16_t port) {
    util::tcp::bind(sock, port);
    util::tcp::listen(sock);
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportServer<BUFFER_SIZE>::write_impl(const uint8_t* data, size_t size) {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportServer<BUFFER_SIZE, QueuePair>::write_impl(const uint8_t* data, size_t size) {
+   if constexpr (datastructure::BasicVirtualRDMARingBuffer<QueuePair>::supportsRendezvous) {
+      // only opt-in, since it doesn't pipeline like the ring, and waits for the receiver
+      if (size >= rendezvous_threshold && rdma->registrations().find(data, size) != nullptr) {
+         rdma->sendRendezvous(data, size);
+         return;
+      }
+   }
    for (size_t i = 0; i < size;) {
-      auto chunk = std::min(size - i, BUFFER_SIZE - 2 * sizeof(size_t));
+      auto chunk = std::min(size - i, chunk_size);
       rdma->send(&data[i], chunk);
       i += chunk;
    }
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportServer<BUFFER_SIZE>::read_impl(uint8_t* buffer, size_t size) {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportServer<BUFFER_SIZE, QueuePair>::read_impl(uint8_t* buffer, size_t size) {
+   // independent of how the sender chunked its writes
    for (size_t i = 0; i < size;) {
-      auto chunk = std::min(size - i, BUFFER_SIZE - 2 * sizeof(size_t));
-      rdma->receive(&buffer[i], chunk);
-      i += chunk;
+      i += rdma->receiveSome(&buffer[i], size - i);
    }
 }
 
-template<size_t BUFFER_SIZE>
-size_t RdmaTransportServer<BUFFER_SIZE>::readSome_impl(uint8_t* buffer, size_t size) {
-    auto chunk = std::min(size, BUFFER_SIZE);
-    return rdma->receive(buffer, chunk);
+template<size_t BUFFER_SIZE, typename QueuePair>
+size_t RdmaTransportServer<BUFFER_SIZE, QueuePair>::readSome_impl(uint8_t* buffer, size_t size) {
+   return rdma->receiveSome(buffer, size);
+}
+
+template<size_t BUFFER_SIZE, typename QueuePair>
+bool RdmaTransportServer<BUFFER_SIZE, QueuePair>::readable_impl(size_t) {
+   return rdma->receiveAvailable();
+}
+
+template<size_t BUFFER_SIZE, typename QueuePair>
+bool RdmaTransportServer<BUFFER_SIZE, QueuePair>::writable_impl(size_t size) {
+   return rdma->sendAvailable(std::min(size, chunk_size));
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportClient<BUFFER_SIZE>::connect_impl(const std::string &connection) {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportClient<BUFFER_SIZE, QueuePair>::connect_impl(const std::string &connection) {
    const auto pos = connection.find(':');
    if (pos == std::string::npos) {
       throw std::runtime_error("usage: <0.0.0.0:port>");
@@ -131,35 +215,50 @@ void RdmaTransportClient<BUFFER_SIZE>::connect_impl(const std::string &connectio
    const auto port = std::stoi(std::string(connection.begin() + pos + 1, connection.end()));
 
    util::tcp::connect(sock, ip, port);
-   rdma = std::make_unique<datastructure::VirtualRDMARingBuffer>(BUFFER_SIZE, sock);
+   rdma = std::make_unique<datastructure::BasicVirtualRDMARingBuffer<QueuePair>>(BUFFER_SIZE, sock);
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportClient<BUFFER_SIZE>::write_impl(const uint8_t* data, size_t size) {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportClient<BUFFER_SIZE, QueuePair>::write_impl(const uint8_t* data, size_t size) {
+   if constexpr (datastructure::BasicVirtualRDMARingBuffer<QueuePair>::supportsRendezvous) {
+      // only opt-in, since it doesn't pipeline like the ring, and waits for the receiver
+      if (size >= rendezvous_threshold && rdma->registrations().find(data, size) != nullptr) {
+         rdma->sendRendezvous(data, size);
+         return;
+      }
+   }
    for (size_t i = 0; i < size;) {
-      auto chunk = std::min(size - i, BUFFER_SIZE - 2 * sizeof(size_t));
+      auto chunk = std::min(size - i, chunk_size);
       rdma->send(&data[i], chunk);
       i += chunk;
    }
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportClient<BUFFER_SIZE>::read_impl(uint8_t* buffer, size_t size) {
-   for (size_t i = 0; i < size;) { // TODO chunked read doesn't work right now...
-      auto chunk = std::min(size - i, BUFFER_SIZE - 2 * sizeof(size_t));
-      rdma->receive(&buffer[i], chunk);
-      i += chunk;
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportClient<BUFFER_SIZE, QueuePair>::read_impl(uint8_t* buffer, size_t size) {
+   // independent of how the sender chunked its writes
+   for (size_t i = 0; i < size;) {
+      i += rdma->receiveSome(&buffer[i], size - i);
    }
 }
 
-template<size_t BUFFER_SIZE>
-size_t RdmaTransportClient<BUFFER_SIZE>::readSome_impl(uint8_t* buffer, size_t size) {
-    auto chunk = std::min(size, BUFFER_SIZE);
-    return rdma->receive(buffer, chunk);
+template<size_t BUFFER_SIZE, typename QueuePair>
+size_t RdmaTransportClient<BUFFER_SIZE, QueuePair>::readSome_impl(uint8_t* buffer, size_t size) {
+   return rdma->receiveSome(buffer, size);
+}
+
+template<size_t BUFFER_SIZE, typename QueuePair>
+bool RdmaTransportClient<BUFFER_SIZE, QueuePair>::readable_impl(size_t) {
+   return rdma->receiveAvailable();
+}
+
+template<size_t BUFFER_SIZE, typename QueuePair>
+bool RdmaTransportClient<BUFFER_SIZE, QueuePair>::writable_impl(size_t size) {
+   return rdma->sendAvailable(std::min(size, chunk_size));
 }
 
-template<size_t BUFFER_SIZE>
-void RdmaTransportClient<BUFFER_SIZE>::reset_impl() {
+template<size_t BUFFER_SIZE, typename QueuePair>
+void RdmaTransportClient<BUFFER_SIZE, QueuePair>::reset_impl() {
    sock = util::Socket::create();
    rdma.reset();
 }
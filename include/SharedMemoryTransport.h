@@ -36,6 +36,13 @@ class SharedMemoryTransportServer : public TransportServer<SharedMemoryTransport
    void read_impl(uint8_t* buffer, size_t size);
 
    size_t readSome_impl(uint8_t *buffer, size_t maxSize);
+
+   bool readable_impl(size_t size);
+
+   bool writable_impl(size_t size);
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return messageBuffer ? messageBuffer->stats() : util::TransportStats{}; }
 };
 
 template<size_t BUFFER_SIZE = 16 * 1024 * 1024>
@@ -58,6 +65,13 @@ class SharedMemoryTransportClient : public TransportClient<SharedMemoryTransport
    void read_impl(uint8_t* buffer, size_t size);
 
    size_t readSome_impl(uint8_t *buffer, size_t maxSize);
+
+   bool readable_impl(size_t size);
+
+   bool writable_impl(size_t size);
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return messageBuffer ? messageBuffer->stats() : util::TransportStats{}; }
 };
 
 template<size_t BUFFER_SIZE>
@@ -99,6 +113,16 @@ size_t SharedMemoryTransportServer<BUFFER_SIZE>::readSome_impl(uint8_t* buffer,
    return messageBuffer->receiveSome(buffer, chunk);
 }
 
+template<size_t BUFFER_SIZE>
+bool SharedMemoryTransportServer<BUFFER_SIZE>::readable_impl(size_t size) {
+   return messageBuffer->receiveAvailable(std::min(size, BUFFER_SIZE));
+}
+
+template<size_t BUFFER_SIZE>
+bool SharedMemoryTransportServer<BUFFER_SIZE>::writable_impl(size_t size) {
+   return messageBuffer->sendAvailable(std::min(size, BUFFER_SIZE));
+}
+
 template<size_t BUFFER_SIZE>
 void SharedMemoryTransportClient<BUFFER_SIZE>::connect_impl(const std::string &file) {
    const auto pos = file.find(':');
@@ -133,6 +157,16 @@ size_t SharedMemoryTransportClient<BUFFER_SIZE>::readSome_impl(uint8_t* buffer,
    return messageBuffer->receiveSome(buffer, chunk);
 }
 
+template<size_t BUFFER_SIZE>
+bool SharedMemoryTransportClient<BUFFER_SIZE>::readable_impl(size_t size) {
+   return messageBuffer->receiveAvailable(std::min(size, BUFFER_SIZE));
+}
+
+template<size_t BUFFER_SIZE>
+bool SharedMemoryTransportClient<BUFFER_SIZE>::writable_impl(size_t size) {
+   return messageBuffer->sendAvailable(std::min(size, BUFFER_SIZE));
+}
+
 template<size_t BUFFER_SIZE>
 void SharedMemoryTransportClient<BUFFER_SIZE>::reset_impl() {
    socket = util::domain::socket();
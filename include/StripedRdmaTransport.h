@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include "util/socket/Socket.h"
+#include "datastructures/VirtualRDMARingBuffer.h"
+#include "util/socket/tcp.h"
+#include "Transport.h"
+
+namespace l5 {
+namespace transport {
+/**
+ * STRIPES RDMA ring buffers, each with its own queue pair, that together carry one logical stream.
+ * Writes are cut into chunks of at most CHUNK_SIZE byte, which go round robin to the stripes. Every stripe delivers
+ * in order, and both ends rotate the same way, so reading the stripes in the same rotation reassembles the stream in
+ * order. Since the ring buffers only signal every few thousand work requests, the chunks of one write are in flight on
+ * all queue pairs at the same time.
+ * Reads don't need to match the writes, a partially read chunk is continued by the next read.
+ */
+template<size_t STRIPES, size_t BUFFER_SIZE, size_t CHUNK_SIZE>
+class RdmaStripes {
+   static_assert(STRIPES > 0, "");
+   static_assert(CHUNK_SIZE + 2 * sizeof(size_t) <= BUFFER_SIZE, "a chunk needs to fit into a stripe's ring buffer");
+
+   std::array<std::unique_ptr<datastructure::VirtualRDMARingBuffer>, STRIPES> stripes;
+   size_t nextSend = 0;
+   size_t nextReceive = 0;
+
+   public:
+   /// Establish all stripes with the remote side of sock, which does the same
+   explicit RdmaStripes(const util::Socket &sock) {
+      for (auto &stripe : stripes) {
+         stripe = std::make_unique<datastructure::VirtualRDMARingBuffer>(BUFFER_SIZE, sock);
+      }
+   }
+
+   void write(const uint8_t* data, size_t size) {
+      for (size_t i = 0; i < size;) {
+         const auto chunk = std::min(size - i, CHUNK_SIZE);
+         stripes[nextSend]->send(&data[i], chunk);
+         nextSend = (nextSend + 1) % STRIPES;
+         i += chunk;
+      }
+   }
+
+   void read(uint8_t* buffer, size_t size) {
+      for (size_t i = 0; i < size;) {
+         i += readSome(&buffer[i], size - i);
+      }
+   }
+
+   /// Reads (the rest of) the next chunk, or the first maxSize byte of it
+   size_t readSome(uint8_t* buffer, size_t maxSize) {
+      if (maxSize == 0) {
+         return 0;
+      }
+      const auto received = stripes[nextReceive]->receiveSome(buffer, maxSize);
+      if (not stripes[nextReceive]->hasPartialMessage()) {
+         nextReceive = (nextReceive + 1) % STRIPES;
+      }
+      return received;
+   }
+
+   bool readable() const {
+      return stripes[nextReceive]->receiveAvailable();
+   }
+
+   bool writable(size_t size) {
+      return stripes[nextSend]->sendAvailable(std::min(size, CHUNK_SIZE));
+   }
+
+   /// Counters summed over all stripes
+   util::TransportStats stats() const {
+      auto result = util::TransportStats{};
+      for (const auto &stripe : stripes) {
+         result += stripe->stats();
+      }
+      return result;
+   }
+};
+
+/**
+ * Transport for bulk transfers, that stripes each write over STRIPES queue pairs (see RdmaStripes). A single queue pair
+ * is limited by the NIC's per-QP processing, and can't saturate a 100G+ link on its own.
+ * For latency bound request / response traffic, RdmaTransport is the better choice.
+ */
+template<size_t STRIPES = 4, size_t BUFFER_SIZE = 16 * 1024 * 1024, size_t CHUNK_SIZE = 256 * 1024>
+class StripedRdmaTransportServer
+      : public TransportServer<StripedRdmaTransportServer<STRIPES, BUFFER_SIZE, CHUNK_SIZE>> {
+   const util::Socket sock;
+   std::unique_ptr<RdmaStripes<STRIPES, BUFFER_SIZE, CHUNK_SIZE>> rdma = nullptr;
+
+   public:
+   static constexpr auto buffer_size = BUFFER_SIZE;
+
+   explicit StripedRdmaTransportServer(const std::string &port) : sock(util::Socket::create()) {
+      util::tcp::bind(sock, std::stoi(port));
+      util::tcp::listen(sock);
+   }
+
+   ~StripedRdmaTransportServer() override = default;
+
+   void accept_impl() {
+      auto acced = util::tcp::accept(sock);
+      rdma = std::make_unique<RdmaStripes<STRIPES, BUFFER_SIZE, CHUNK_SIZE>>(acced);
+   }
+
+   void write_impl(const uint8_t* data, size_t size) { rdma->write(data, size); }
+
+   void read_impl(uint8_t* buffer, size_t size) { rdma->read(buffer, size); }
+
+   size_t readSome_impl(uint8_t* buffer, size_t maxSize) { return rdma->readSome(buffer, maxSize); }
+
+   bool readable_impl(size_t) { return rdma->readable(); }
+
+   bool writable_impl(size_t size) { return rdma->writable(size); }
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return rdma ? rdma->stats() : util::TransportStats{}; }
+};
+
+template<size_t STRIPES = 4, size_t BUFFER_SIZE = 16 * 1024 * 1024, size_t CHUNK_SIZE = 256 * 1024>
+class StripedRdmaTransportClient
+      : public TransportClient<StripedRdmaTransportClient<STRIPES, BUFFER_SIZE, CHUNK_SIZE>> {
+   util::Socket sock;
+   std::unique_ptr<RdmaStripes<STRIPES, BUFFER_SIZE, CHUNK_SIZE>> rdma = nullptr;
+
+   public:
+   static constexpr auto buffer_size = BUFFER_SIZE;
+
+   StripedRdmaTransportClient() : sock(util::Socket::create()) {}
+
+   ~StripedRdmaTransportClient() override = default;
+
+   StripedRdmaTransportClient(StripedRdmaTransportClient&&) noexcept = default;
+
+   StripedRdmaTransportClient& operator=(StripedRdmaTransportClient&&) noexcept = default;
+
+   void connect_impl(const std::string &connection) {
+      const auto pos = connection.find(':');
+      if (pos == std::string::npos) {
+         throw std::runtime_error("usage: <0.0.0.0:port>");
+      }
+      const auto ip = std::string(connection.data(), pos);
+      const auto port = std::stoi(std::string(connection.begin() + pos + 1, connection.end()));
+
+      util::tcp::connect(sock, ip, port);
+      rdma = std::make_unique<RdmaStripes<STRIPES, BUFFER_SIZE, CHUNK_SIZE>>(sock);
+   }
+
+   void reset_impl() {
+      sock = util::Socket::create();
+      rdma.reset();
+   }
+
+   void write_impl(const uint8_t* data, size_t size) { rdma->write(data, size); }
+
+   void read_impl(uint8_t* buffer, size_t size) { rdma->read(buffer, size); }
+
+   size_t readSome_impl(uint8_t* buffer, size_t maxSize) { return rdma->readSome(buffer, maxSize); }
+
+   bool readable_impl(size_t) { return rdma->readable(); }
+
+   bool writable_impl(size_t size) { return rdma->writable(size); }
+
+   /// Counters of the current connection, all 0 unless built with L5RDMA_STATS
+   util::TransportStats stats() const { return rdma ? rdma->stats() : util::TransportStats{}; }
+};
+} // namespace transport
+} // namespace l5
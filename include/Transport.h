@@ -56,6 +56,18 @@ public:
         return data;
     }
 
+    /**
+     * Non-blocking check, if a read of size bytes can be served without waiting for the remote end
+     * Only supported by the ring buffer based transports
+     */
+    bool readable(size_t size) { return static_cast<T *>(this)->readable_impl(size); }
+
+    /**
+     * Non-blocking check, if a write of size bytes can be issued without waiting for the remote end
+     * Only supported by the ring buffer based transports
+     */
+    bool writable(size_t size) { return static_cast<T *>(this)->writable_impl(size); }
+
     virtual ~TransportServer() = default;
 };
 
@@ -99,6 +111,13 @@ public:
         read(reinterpret_cast<uint8_t *>(&data), sizeof(data));
     }
 
+    /**
+     * Similar interface to TransportServer
+     */
+    bool readable(size_t size) { return static_cast<T *>(this)->readable_impl(size); }
+
+    bool writable(size_t size) { return static_cast<T *>(this)->writable_impl(size); }
+
     virtual ~TransportClient() = default;
 };
 
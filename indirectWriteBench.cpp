@@ -569,7 +569,7 @@ int main(int argc, char **argv) {
         ip = argv[2];
     }
 
-    cout << "size, connection, messages, seconds, msgps, user, kernel, total" << '\n';
+    cout << "size, connection, messages, seconds, msgps, user, kernel, total" << perfHeader() << '\n';
     for (const size_t length : {1u, 2u, 4u, 8u, 16u, 32u, 64u, 128u, 256u, 512u}) {
         cout << length << ", ImmPos, ";
         runImmData<rdma::RcQueuePair>(isClient, length);
@@ -0,0 +1,102 @@
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "apps/ShardedKVStore.h"
+#include "include/MulticlientRDMATransport.h"
+#include "util/bench.h"
+#include "util/Random32.h"
+
+using namespace std;
+using namespace l5::transport;
+
+static constexpr uint16_t port = 1234;
+static const char *ip = "127.0.0.1";
+static constexpr size_t KEYS = 1024 * 1024;
+static constexpr size_t CLIENTS = 16;
+static constexpr size_t MESSAGES = 256 * 1024; // per client
+
+void runServer(size_t shardCount) {
+    auto store = ShardedKVStore(port, shardCount, CLIENTS);
+    for (uint64_t key = 0; key < KEYS; ++key) {
+        store.insert(key, key + 1);
+    }
+    store.start(CLIENTS);
+
+    bench(CLIENTS * MESSAGES, [&] {
+        while (store.processed() < CLIENTS * MESSAGES) {
+            this_thread::sleep_for(1ms);
+        }
+    });
+}
+
+void runClients(size_t shardCount, size_t keysPerRequest) {
+    // a MULTI_GET may only contain keys of one shard
+    auto keysOfShard = vector<vector<uint64_t>>(shardCount);
+    for (uint64_t key = 0; key < KEYS; ++key) {
+        keysOfShard[ShardedKVStore::shardOf(key, shardCount)].push_back(key);
+    }
+
+    sleep(1);
+    vector<thread> clientThreads;
+    bench(CLIENTS * MESSAGES, [&] {
+        for (size_t c = 0; c < CLIENTS; ++c) {
+            clientThreads.emplace_back([&, c] {
+                // one connection to every shard
+                auto connections = vector<MultiClientRDMATransportClient>(shardCount);
+                for (size_t s = 0; s < shardCount; ++s) {
+                    connections[s].connect(ip, port + s);
+                }
+
+                auto rand = Random32(c + 1);
+                auto keys = vector<uint64_t>(keysPerRequest);
+                auto values = vector<uint64_t>(keysPerRequest);
+                for (size_t i = 0; i < MESSAGES; ++i) {
+                    const auto shard = rand.next() % shardCount;
+                    const auto &candidates = keysOfShard[shard];
+                    for (auto &key : keys) {
+                        key = candidates[rand.next() % candidates.size()];
+                    }
+
+                    auto &connection = connections[shard];
+                    connection.send([&](uint8_t *begin) {
+                        const auto header = KvHeader{KvOpcode::MULTI_GET, {}, static_cast<uint32_t>(keys.size())};
+                        std::memcpy(begin, &header, sizeof(header));
+                        std::memcpy(begin + sizeof(header), keys.data(), keys.size() * sizeof(uint64_t));
+                        return sizeof(header) + keys.size() * sizeof(uint64_t);
+                    });
+                    connection.receive(values.data(), values.size() * sizeof(uint64_t));
+                    for (size_t k = 0; k < keys.size(); ++k) {
+                        if (values[k] != keys[k] + 1) {
+                            throw runtime_error{"unexpected value"};
+                        }
+                    }
+                }
+            });
+        }
+        for (auto &t : clientThreads) t.join();
+    });
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " <client / server> <(IP, optional) 127.0.0.1>" << endl;
+        return -1;
+    }
+    const auto isClient = argv[1][0] == 'c';
+    if (argc > 2) {
+        ip = argv[2];
+    }
+
+    cout << "shards, clients, keys per request, messages, seconds, msgps, user, system, total" << perfHeader() << "\n";
+    for (const size_t keysPerRequest : {1u, 16u}) {
+        for (const size_t shards : {1u, 2u, 4u, 8u, 16u}) {
+            cout << shards << ", " << CLIENTS << ", " << keysPerRequest << ", ";
+            if (isClient) {
+                runClients(shards, keysPerRequest);
+            } else {
+                runServer(shards);
+            }
+        }
+    }
+    return 0;
+}
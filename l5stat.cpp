@@ -0,0 +1,128 @@
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <tuple>
+#include <signal.h>
+#include "util/StatsSegment.h"
+#include "util/virtualMemory.h"
+
+using namespace std;
+using namespace l5::util;
+
+/// Watch the transport statistics, that running processes publish with L5RDMA_STATS_SHM=1, similar to vmstat
+
+struct Sample {
+    uint32_t generation;
+    TransportStats stats;
+};
+
+/// pid, slot
+using SlotId = tuple<pid_t, size_t>;
+
+static bool isAlive(pid_t pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+/// Attach to all stats segments of live processes (or only the one of onlyPid)
+static map<pid_t, ShmMapping<const StatsSegmentHeader>> attachAll(pid_t onlyPid) {
+    auto result = map<pid_t, ShmMapping<const StatsSegmentHeader>>();
+    const auto prefix = string(statsSegmentPrefix);
+    for (const auto &entry : filesystem::directory_iterator("/dev/shm")) {
+        const auto file = entry.path().filename().string();
+        if (file.compare(0, prefix.size(), prefix) != 0) continue;
+        // skip files, that merely share the prefix
+        const auto first = file.data() + prefix.size();
+        const auto last = file.data() + file.size();
+        auto pid = pid_t{};
+        const auto[end, error] = from_chars(first, last, pid);
+        if (error != errc{} || end != last || pid <= 0) continue;
+        if ((onlyPid != 0 && pid != onlyPid) || not isAlive(pid)) continue;
+        try {
+            auto segment = attach_shared<StatsSegmentHeader>("/" + file);
+            struct stat info{};
+            fstat(segment.fd, &info);
+            const auto header = segment.data.get();
+            if (header->magic.load(memory_order_acquire) != statsSegmentMagic() ||
+                static_cast<size_t>(info.st_size) < statsSegmentSize(header->slotCount)) {
+                continue; // not (yet) initialized
+            }
+            result.emplace(pid, move(segment));
+        } catch (const runtime_error &) {
+            // the process just exited
+        }
+    }
+    return result;
+}
+
+static void printHeader() {
+    cout << setw(8) << "pid" << setw(42) << "connection" << setw(10) << "msg/s out" << setw(10) << "MB/s out"
+         << setw(10) << "msg/s in" << setw(10) << "MB/s in" << setw(12) << "occupancy" << setw(10) << "stalls/s"
+         << setw(12) << "spins/s" << setw(12) << "compl/s" << setw(12) << "empty cq/s" << setw(10) << "inline/s"
+         << setw(10) << "drops/s" << '\n';
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && argv[1][0] == '-') {
+        cout << "Usage: " << argv[0] << " <delay in seconds = 1> <count = forever> <pid = all>" << endl;
+        cout << "Processes publish their statistics, when built with -DL5RDMA_STATS=ON and run with L5RDMA_STATS_SHM=1"
+             << endl;
+        return -1;
+    }
+    const auto delay = argc > 1 ? stod(argv[1]) : 1.0;
+    const auto count = argc > 2 ? stoul(argv[2]) : 0ul;
+    const auto onlyPid = argc > 3 ? static_cast<pid_t>(stol(argv[3])) : 0;
+
+    auto previous = map<SlotId, Sample>();
+    auto lastTime = chrono::steady_clock::now();
+    size_t rows = 0;
+    for (size_t iteration = 0; count == 0 || iteration <= count; ++iteration) {
+        const auto now = chrono::steady_clock::now();
+        const auto seconds = chrono::duration<double>(now - lastTime).count();
+        lastTime = now;
+
+        auto current = map<SlotId, Sample>();
+        for (const auto &[pid, segment] : attachAll(onlyPid)) {
+            const auto header = segment.data.get();
+            const auto slots = statsSlots(header);
+            for (size_t i = 0; i < header->slotCount; ++i) {
+                const auto &slot = slots[i];
+                if (slot.state.load(memory_order_acquire) != StatsSlot::Used) continue;
+                const auto sample = Sample{slot.generation.load(memory_order_relaxed), slot.counters.snapshot()};
+                current[{pid, i}] = sample;
+
+                // the first sample of a connection only serves as base for the rates
+                const auto before = previous.find({pid, i});
+                if (before == previous.end() || before->second.generation != sample.generation) continue;
+                const auto rate = [&](auto member) {
+                    return static_cast<double>(sample.stats.*member - before->second.stats.*member) / seconds;
+                };
+
+                const auto name = string(slot.name, strnlen(slot.name, sizeof(slot.name)));
+                if (rows++ % 20 == 0) printHeader();
+                cout << fixed << setprecision(0) << setw(8) << pid << setw(42) << name
+                     << setw(10) << rate(&TransportStats::messagesSent)
+                     << setprecision(1) << setw(10) << rate(&TransportStats::bytesSent) / 1e6
+                     << setprecision(0) << setw(10) << rate(&TransportStats::messagesReceived)
+                     << setprecision(1) << setw(10) << rate(&TransportStats::bytesReceived) / 1e6
+                     << setw(12) << sample.stats.ringOccupancy
+                     << setprecision(0) << setw(10) << rate(&TransportStats::sendStalls)
+                     << setw(12) << rate(&TransportStats::waitSpins) << setw(12) << rate(&TransportStats::completions)
+                     << setw(12) << rate(&TransportStats::emptyCqPolls) << setw(10) << rate(&TransportStats::inlinedWrs)
+                     << setw(10) << rate(&TransportStats::droppedMessages) << '\n';
+            }
+        }
+        cout << flush;
+        previous = move(current);
+
+        if (count == 0 || iteration < count) {
+            this_thread::sleep_for(chrono::duration<double>(delay));
+        }
+    }
+    return 0;
+}
@@ -84,7 +84,7 @@ int main(int argc, char **argv) {
         ip = argv[3];
     }
 
-    cout << "clients, messages, seconds, msgps, user, kernel, total\n";
+    cout << "clients, messages, seconds, msgps, user, kernel, total" << perfHeader() << "\n";
     if (!isClient) {
         cout << clients << ", ";
     }
@@ -1,9 +1,10 @@
+#include <atomic>
 #include <iostream>
 #include <thread>
 #include <iomanip>
-#include <map>
 #include "include/MulticlientRDMATransport.h"
 #include "util/bench.h"
+#include "util/Histogram.h"
 #include "util/ycsb.h"
 #include "util/Random32.h"
 #include "util/doNotOptimize.h"
@@ -42,8 +43,11 @@ void doRun(const size_t msgps, bool isClient) {
 
     if (isClient) {
         std::vector<size_t> counters(threadsPerClient);
-        std::vector<std::vector<double>> latencySamples(threadsPerClient);
+        std::vector<Histogram> latencies(threadsPerClient);
         std::vector<std::thread> clientThreads;
+        // only the timed messages are measured, not connecting and warming up
+        std::atomic<size_t> ready = 0;
+        std::atomic<bool> go = false;
 
         for (size_t c = 0; c < threadsPerClient; ++c) {
             clientThreads.emplace_back([&, c] {
@@ -60,54 +64,48 @@ void doRun(const size_t msgps, bool isClient) {
                     client.read(response);
                     DoNotOptimize(response);
                 }
-
+                ++ready;
+                while (not go);
 
                 static constexpr size_t timedMessages = 50;
 
                 for (size_t i = 0; i < lookupKeys.size(); i += timedMessages) {
                     using namespace std::chrono;
-                    const auto start = high_resolution_clock::now();
 
                     for (size_t j = 0; j < timedMessages; ++j) {
+                        const auto start = steady_clock::now();
                         const auto field = rand.next() % ycsb_field_count;
                         const auto message = ReadMessage{lookupKeys[i], field};
                         client.write(message);
                         client.read(response);
                         DoNotOptimize(response);
                         ++counters[c];
+                        const auto end = steady_clock::now();
+                        latencies[c].record(static_cast<uint64_t>(duration_cast<nanoseconds>(end - start).count()));
                     }
 
-                    const auto end = std::chrono::high_resolution_clock::now();
-                    const auto muSecs = chrono::duration<double, micro>(end - start).count();
-                    latencySamples[c].push_back(muSecs / timedMessages);
-
                     this_thread::sleep_for(
                             duration_cast<nanoseconds>(chrono::duration<double>(double(timedMessages) / msgps)));
                 }
             });
         }
-        for (auto &t : clientThreads) {
-            t.join();
-        }
-
-        std::vector<double> roundedSamples;
-        for (const auto &samples : latencySamples) {
-            for (const auto sample : samples) {
-                roundedSamples.push_back(std::nearbyint(sample * 100) / 100); // round to 2 decimals
+        while (ready < threadsPerClient);
+
+        // latencies in us
+        std::cout << "target msgps, messages, time, msgps, user, system, total, " << Histogram::summaryHeader()
+                  << perfHeader() << '\n';
+        cout << msgps * threadsPerClient * numberOfClients << ", ";
+        benchLatency(msgps * duration * threadsPerClient, [&](Histogram &merged) {
+            go = true;
+            for (auto &t : clientThreads) {
+                t.join();
             }
-        }
-
-        std::map<double, size_t> summed;
-        for (const auto sample : roundedSamples) {
-            ++summed[sample];
-        }
-
-        std::cout << "msgps, latency, count\n";
-        for (const auto[latency, count] : summed) {
-            cout << msgps * threadsPerClient * numberOfClients << ", " << latency << ", " << count << '\n';
-        }
+            for (const auto &histogram : latencies) {
+                merged.merge(histogram);
+            }
+        });
     } else { // server
-        const auto database = YcsbDatabase();
+        const auto database = YcsbDatabase::openSnapshot();
         auto server = MulticlientRDMATransportServer(to_string(port));
         std::cout << "Letting " << numberOfClients << " clients connect\n";
         for (size_t i = 0; i < numberOfClients * threadsPerClient; ++i) {
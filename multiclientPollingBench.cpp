@@ -612,7 +612,7 @@ int main(int argc, char **argv) {
         ip = argv[2];
     }
 
-    cout << "size, connection, clients, messages, seconds, msgps, user, kernel, total" << '\n';
+    cout << "size, connection, clients, messages, seconds, msgps, user, kernel, total" << perfHeader() << '\n';
     const auto length = 64;
     for (const size_t clients : {1u, 2u, 4u, 8u, 16u, 32u, 64u, 128u, 192u, 256u}) {
         cout << length << ", Write + Immediate, " << clients << ", ";
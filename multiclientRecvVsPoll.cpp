@@ -1,6 +1,8 @@
 #include "include/MulticlientRDMADistinctMrTransport.h"
 #include "include/MulticlientRDMARecvTransport.h"
+#include "include/MulticlientRDMAMpscTransport.h"
 #include "include/MulticlientRDMATransport.h"
+#include "include/MulticlientRDMAUdTransport.h"
 #include "include/RdmaTransport.h"
 #include "util/Random32.h"
 #include "util/bench.h"
@@ -158,7 +160,8 @@ int main(int argc, char** argv) {
       connectionString = std::to_string(port);
    }
 
-   if (!isClient) std::cout << "concurrent, method, messages, seconds, msgps, user, kernel, total\n";
+   if (!isClient)
+      std::cout << "concurrent, method, messages, seconds, msgps, user, kernel, total" << perfHeader() << "\n";
    if (concurrent) {
       // MulticlientRDMADistinctMr -> Suitable for *few* clients (x < ???)
       doRun<MulticlientRDMADistinctMrTransportServer, MulticlientRDMADistinctMrTransportClient>(isClient, connectionString, *concurrent, ", Direct, ");
@@ -166,6 +169,10 @@ int main(int argc, char** argv) {
       doRun<MulticlientRDMATransportServer, MultiClientRDMATransportClient>(isClient, connectionString, *concurrent, ", Doorbells, ");
       // MulticlientRDMARecv -> Suitable for *many* clients (9 < x)
       doRun<MulticlientRDMARecvTransportServer, MulticlientRDMARecvTransportClient>(isClient, connectionString, *concurrent, ", Recv, ");
+      // MulticlientRDMAUd -> a single queue pair on the server, for *very many* clients
+      doRun<MulticlientRDMAUdTransportServer, MulticlientRDMAUdTransportClient>(isClient, connectionString, *concurrent, ", UD, ");
+      // MulticlientRDMAMpsc -> one shared ring on the server, no door bell scan
+      doRun<MulticlientRDMAMpscTransportServer, MulticlientRDMAMpscTransportClient>(isClient, connectionString, *concurrent, ", MPSC, ");
    } else {
       for (size_t i = 1; i < 50; ++i) {
          // MulticlientRDMADistinctMr -> Suitable for *few* clients (x < ???)
@@ -174,6 +181,10 @@ int main(int argc, char** argv) {
          doRun<MulticlientRDMATransportServer, MultiClientRDMATransportClient>(isClient, connectionString, i, ", Doorbells, ");
          // MulticlientRDMARecv -> Suitable for *many* clients (9 < x)
          doRun<MulticlientRDMARecvTransportServer, MulticlientRDMARecvTransportClient>(isClient, connectionString, i, ", Recv, ");
+         // MulticlientRDMAUd -> a single queue pair on the server, for *very many* clients
+         doRun<MulticlientRDMAUdTransportServer, MulticlientRDMAUdTransportClient>(isClient, connectionString, i, ", UD, ");
+         // MulticlientRDMAMpsc -> one shared ring on the server, no door bell scan
+         doRun<MulticlientRDMAMpscTransportServer, MulticlientRDMAMpscTransportClient>(isClient, connectionString, i, ", MPSC, ");
       }
    }
 }
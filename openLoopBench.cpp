@@ -0,0 +1,144 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "include/MulticlientRDMATransport.h"
+#include "include/RdmaTransport.h"
+#include "include/SharedMemoryTransport.h"
+#include "util/Histogram.h"
+#include "util/OpenLoop.h"
+#include "util/bench.h"
+#include "util/TransportStats.h"
+
+using namespace std;
+using namespace l5::transport;
+using namespace l5::util;
+
+static constexpr uint16_t port = 1234;
+static const char *ip = "127.0.0.1";
+static constexpr auto shmPath = "/tmp/openLoopBench";
+static constexpr size_t WINDOW = 64; // outstanding requests per one-to-one connection
+static constexpr size_t LANES = 16; // connections of the multi-client transport
+static constexpr double SECONDS = 1; // per rate
+static const auto RATES = {10'000.0, 50'000.0, 100'000.0, 200'000.0, 500'000.0};
+
+struct Message {
+    uint64_t payload[8];
+};
+
+size_t messagesOf(double rate) {
+    return static_cast<size_t>(rate * SECONDS);
+}
+
+template<typename Lane>
+void measure(vector<Lane> &lanes, const char *connection, ArrivalProcess process) {
+    for (const auto rate : RATES) {
+        auto schedule = ArrivalSchedule(rate, process);
+        cout << connection << ", " << (process == ArrivalProcess::Poisson ? "poisson" : "constant") << ", "
+             << rate << ", ";
+        benchLatency(messagesOf(rate), [&](Histogram &latencies) {
+            return runOpenLoop(lanes, schedule, messagesOf(rate), latencies).delayed;
+        });
+        cout << flush;
+    }
+}
+
+template<typename Server>
+void echo(Server &server) {
+    for (const auto rate : RATES) {
+        for (size_t i = 0; i < messagesOf(rate); ++i) {
+            auto message = Message{};
+            server.read(message);
+            server.write(message);
+        }
+    }
+}
+
+template<typename Server, typename Client>
+void runOneToOne(bool isClient, const string &connection, const char *name, ArrivalProcess process) {
+    if (isClient) {
+        auto client = Client();
+        for (int i = 0;; ++i) {
+            try {
+                client.connect(connection);
+                break;
+            } catch (...) {
+                this_thread::sleep_for(20ms);
+                if (i > 1000) throw;
+            }
+        }
+        auto lanes = vector<PipelinedLane<Client, Message, Message>>{{client, WINDOW}};
+        measure(lanes, name, process);
+        if (statsEnabled) cerr << TransportStats::header() << '\n' << client.stats() << endl;
+    } else {
+        auto server = Server(connection);
+        server.accept();
+        echo(server);
+    }
+}
+
+void runMultiClient(bool isClient, ArrivalProcess process) {
+    if (isClient) {
+        auto clients = vector<MultiClientRDMATransportClient>(LANES);
+        auto lanes = vector<MultiClientLane<MultiClientRDMATransportClient, Message>>();
+        for (auto &client : clients) {
+            for (int i = 0;; ++i) {
+                try {
+                    client.connect(ip, port);
+                    break;
+                } catch (...) {
+                    this_thread::sleep_for(20ms);
+                    if (i > 1000) throw;
+                }
+            }
+            lanes.emplace_back(client);
+        }
+        measure(lanes, "multiclient rdma", process);
+        if (statsEnabled) {
+            auto stats = TransportStats();
+            for (const auto &client : clients) {
+                stats += client.stats();
+            }
+            cerr << TransportStats::header() << '\n' << stats << endl;
+        }
+    } else {
+        auto server = MulticlientRDMATransportServer(to_string(port), LANES);
+        for (size_t i = 0; i < LANES; ++i) {
+            server.accept();
+        }
+        for (const auto rate : RATES) {
+            for (size_t i = 0; i < messagesOf(rate); ++i) {
+                auto message = Message{};
+                const auto sender = server.read(message);
+                server.write(sender, message);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <client / server> <SHM|RDMA|MULTI> <constant / poisson>"
+             << " <(IP, optional) 127.0.0.1>" << endl;
+        return -1;
+    }
+    const auto isClient = argv[1][0] == 'c';
+    const auto transport = string_view(argv[2]);
+    const auto process = argc > 3 && argv[3][0] == 'p' ? ArrivalProcess::Poisson : ArrivalProcess::Constant;
+    if (argc > 4) {
+        ip = argv[4];
+    }
+
+    // latencies from the intended send time in us
+    if (isClient) cout << "connection, arrival, rate, messages, time, achieved msgps, user, system, total, delayed, "
+                       << Histogram::summaryHeader() << perfHeader() << "\n";
+    if (transport == "SHM") {
+        runOneToOne<SharedMemoryTransportServer<>, SharedMemoryTransportClient<>>(isClient, shmPath, "shared memory",
+                                                                                  process);
+    } else if (transport == "RDMA") {
+        const auto connection = isClient ? ip + string(":") + to_string(port) : to_string(port);
+        runOneToOne<RdmaTransportServer<>, RdmaTransportClient<>>(isClient, connection, "rdma", process);
+    } else if (transport == "MULTI") {
+        runMultiClient(isClient, process);
+    }
+    return 0;
+}
@@ -67,7 +67,7 @@ int main(int argc, char **argv) {
         ip = argv[3];
     }
 
-    cout << "size, messages, seconds, msgps, user, kernel, total\n";
+    cout << "size, messages, seconds, msgps, user, kernel, total" << perfHeader() << "\n";
     if (!isClient) {
         cout << size << ", ";
     }
@@ -2,20 +2,24 @@
 #include <tbb/tbb.h>
 #include <thread>
 #include "apps/PingPong.h"
+#include "util/Affinity.h"
 #include "util/bench.h"
 
 using namespace std;
 using namespace l5::transport;
+using namespace l5::util;
 
 static constexpr uint16_t port = 1234;
 static const char *ip = "127.0.0.1";
 static constexpr auto MESSAGES = 1024 * 1024;
 
-void doRun(size_t clients, bool isClient) {
+void doRun(size_t clients, bool isClient, const Topology &topology, Spread spread) {
     if (isClient) {
         sleep(2);
         vector<Ping<RdmaTransportClient<>>> rdmaClients;
         for (size_t i = 0; i < clients; ++i) {
+            // create each connection on the CPU of the thread using it, so it gets that node's NIC and memory
+            topology.pin(i, spread);
             rdmaClients.emplace_back(make_transportClient<RdmaTransportClient<>>(),
                                      ip + string(":") + to_string(port + i));
         }
@@ -23,6 +27,7 @@ void doRun(size_t clients, bool isClient) {
         std::vector<std::thread> clientThreads;
         for (size_t i = 0; i < clients; ++i) {
             clientThreads.emplace_back([&, i] {
+                topology.pin(i, spread);
                 for (size_t j = 0; j < MESSAGES; ++j) {
                     rdmaClients[i].ping();
                 }
@@ -32,6 +37,7 @@ void doRun(size_t clients, bool isClient) {
     } else {
         vector<Pong<RdmaTransportServer<>>> servers;
         for (size_t i = 0; i < clients; ++i) {
+            topology.pin(i, spread);
             servers.emplace_back(make_transportServer<RdmaTransportServer<>>(to_string(port + i)));
             servers.back().start();
         }
@@ -40,6 +46,7 @@ void doRun(size_t clients, bool isClient) {
         bench(MESSAGES * clients, [&] {
             for (size_t i = 0; i < clients; ++i) {
                 serverThreads.emplace_back([&, i] {
+                    topology.pin(i, spread);
                     for (size_t j = 0; j < MESSAGES; ++j) {
                         servers[i].pong();
                     }
@@ -54,21 +61,25 @@ void doRun(size_t clients, bool isClient) {
 
 int main(int argc, char **argv) {
     if (argc < 2) {
-        cout << "Usage: " << argv[0] << " <client / server> <(optional) 127.0.0.1>" << endl;
+        cout << "Usage: " << argv[0] << " <client / server> <(optional) 127.0.0.1> <(optional) none / cores / nodes>"
+             << endl;
         return -1;
     }
     const auto isClient = argv[1][0] == 'c';
     if (argc > 2) {
         ip = argv[2];
     }
+    // where to run the threads, see util/Affinity.h. The topology can be overridden with L5RDMA_TOPOLOGY
+    const auto spread = argc > 3 ? parseSpread(argv[3]) : Spread::None;
+    const auto topology = Topology::fromEnvironment();
 
     if (!isClient) {
-        cout << "clients, messages, seconds, msgps, user, kernel, total\n";
+        cout << "clients, messages, seconds, msgps, user, kernel, total" << perfHeader() << "\n";
     }
     for (size_t clients = 1; clients <= 32; ++clients) {
         if (!isClient) {
             cout << clients << ", ";
         }
-        doRun(clients, isClient);
+        doRun(clients, isClient, topology, spread);
     }
 }
@@ -7,6 +7,7 @@
 #include "include/LibRdmacmTransport.h"
 #include "util/bench.h"
 #include "apps/PingPong.h"
+#include "apps/Rpc.h"
 
 using namespace std;
 using namespace l5::transport;
@@ -15,6 +16,7 @@ static const size_t MESSAGES = 256 * 1024;  //~ 1s
 static const size_t SHAREDMEM_MESSAGES = 1024 * 1024;
 static const char *ip = "127.0.0.1";
 static constexpr uint16_t port = 1234;
+static constexpr size_t WINDOW = 16; // outstanding requests in pipelined mode
 
 int main(int argc, char **argv) {
     if (argc < 2) {
@@ -26,7 +28,7 @@ int main(int argc, char **argv) {
         ip = argv[2];
     }
 
-    cout << "size, connection, messages, time, msgps, user, system, total\n";
+    cout << "size, connection, messages, time, msgps, user, system, total" << perfHeader() << "\n";
     for (const size_t size : {1u, 2u, 4u, 8u, 16u, 32u, 64u, 128u, 256u}) {
         if (isClient) {
             //sleep(1);
@@ -71,6 +73,23 @@ int main(int argc, char **argv) {
                     }
                 });
             }
+            sleep(1);
+            {
+                cout << size << ", " << "rdma pipelined, ";
+                auto client = RpcClient(make_transportClient<RdmaTransportClient<>>(),
+                                        ip + string(":") + to_string(port), WINDOW, size);
+                const auto data = vector<uint8_t>(size, 42);
+                size_t completed = 0;
+                bench(SHAREDMEM_MESSAGES, [&]() {
+                    for (size_t i = 0; i < SHAREDMEM_MESSAGES; ++i) {
+                        client.call(data.data(), data.size(), [&](const uint8_t *, size_t) { ++completed; });
+                    }
+                    client.drain();
+                });
+                if (completed != SHAREDMEM_MESSAGES) {
+                    throw runtime_error{"lost responses"};
+                }
+            }
 //        { // librdmacm doesn't seem to work with the current server config
 //            cout << "librdmacm, ";
 //            auto client = Ping(make_transportClient<LibRdmacmTransportClient>(), ip + string(":") + to_string(port));
@@ -121,6 +140,21 @@ int main(int argc, char **argv) {
                     }
                 });
             }
+            {
+                cout << size << ", " << "rdma pipelined, ";
+                auto server = RpcServer(make_transportServer<RdmaTransportServer<>>(to_string(port)), size, size);
+                server.start();
+                bench(SHAREDMEM_MESSAGES, [&]() {
+                    for (size_t i = 0; i < SHAREDMEM_MESSAGES; ++i) {
+                        server.serve([](const uint8_t *request, size_t requestSize, uint8_t *response,
+                                        size_t responseCapacity) {
+                            const auto size = std::min(requestSize, responseCapacity);
+                            std::copy(request, request + size, response);
+                            return size;
+                        });
+                    }
+                });
+            }
 //        {
 //            cout << "librdmacm, ";
 //            auto server = Pong(make_transportServer<LibRdmacmTransportServer>(to_string(port)));
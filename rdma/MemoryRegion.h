@@ -13,7 +13,7 @@ namespace rdma {
 
         RegisteredMemoryRegion(size_t size, rdma::Network &net, std::initializer_list<ibv::AccessFlag> flags) :
                 underlying(size),
-                mr(net.registerMr(underlying.data(), underlying.size() * sizeof(T), flags)) {}
+                mr(net.registerNumaLocalMr(underlying.data(), underlying.size() * sizeof(T), flags)) {}
 
         std::vector<T> &get() {
             return underlying;
@@ -1,18 +1,56 @@
 #include "Network.hpp"
 #include <iostream>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
+#include <map>
+#include <mutex>
 #include "NetworkException.h"
+#include "util/Affinity.h"
 
 using namespace std;
 
-static std::unique_ptr<ibv::context::Context> openUnambigousDevice(ibv::device::DeviceList &devices) {
+namespace {
+/// The NUMA node of an Infiniband device, as reported by sysfs, -1 if unknown
+int numaNodeOf(const string &name) {
+    auto file = ifstream("/sys/class/infiniband/" + name + "/device/numa_node");
+    int node = -1;
+    if (not(file >> node)) {
+        return -1;
+    }
+    return node;
+}
+
+ibv::device::Device *findDevice(ibv::device::DeviceList &devices, const string &name) {
     if (devices.size() == 0) {
         throw rdma::NetworkException("no Infiniband devices available");
-    } else if (devices.size() > 1) {
-        throw rdma::NetworkException("more than 1 Infiniband devices available .. not handled right now");
     }
-    return devices[0]->open();
+    if (name.empty()) {
+        if (devices.size() == 1) {
+            return devices[0];
+        }
+        // prefer the device on our socket, cross-socket DMA is considerably slower
+        const auto node = l5::util::currentNumaNode();
+        for (auto device : devices) {
+            if (numaNodeOf(device->getName()) == node) {
+                return device;
+            }
+        }
+        return devices[0];
+    }
+    for (auto device : devices) {
+        if (name == device->getName()) {
+            return device;
+        }
+    }
+    throw rdma::NetworkException("no Infiniband device named " + name);
+}
+
+string envOr(const char *variable, const string &otherwise) {
+    const auto value = getenv(variable);
+    return value == nullptr ? otherwise : string(value);
 }
+} // namespace
 
 namespace rdma {
     ostream &operator<<(ostream &os, const ibv::memoryregion::RemoteAddress &remoteMemoryRegion) {
@@ -24,32 +62,81 @@ namespace rdma {
         return os << "lid=" << address.lid << ", qpn=" << address.qpn;
     }
 
-    Network::Network() : devices(), context(openUnambigousDevice(devices)), sharedCompletionQueuePair(*context) {
+    Device::Device(const string &name) : devices() {
+        const auto device = findDevice(devices, name);
+        context = device->open();
+        numaNode = numaNodeOf(device->getName());
+
         // Create the protection domain
         protectionDomain = context->allocProtectionDomain();
+    }
+
+    shared_ptr<Device> Device::acquire(const string &name) {
+        static mutex guard;
+        static map<string, weak_ptr<Device>> opened;
 
+        lock_guard<mutex> lock(guard);
+        // resolve the selection first, so asking by name and by NUMA node yields the same instance
+        auto devices = ibv::device::DeviceList();
+        const auto resolvedName = string(findDevice(devices, name)->getName());
+        auto device = opened[resolvedName].lock();
+        if (not device) {
+            device = make_shared<Device>(resolvedName);
+            opened[resolvedName] = device;
+        }
+        return device;
+    }
+
+    Network::Network() : Network(envOr("L5RDMA_DEVICE", ""), static_cast<uint8_t>(stoi(envOr("L5RDMA_PORT", "1")))) {}
+
+    Network::Network(const string &deviceName, uint8_t port) :
+            port(port), device(Device::acquire(deviceName)), sharedCompletionQueuePair(*device->context) {
         // Create receive queue
         ibv::srq::InitAttributes initAttributes(ibv::srq::Attributes(maxWr, maxSge));
-        sharedReceiveQueue = protectionDomain->createSrq(initAttributes);
+        sharedReceiveQueue = device->protectionDomain->createSrq(initAttributes);
+    }
+
+    uint8_t Network::getPort() const {
+        return port;
+    }
+
+    int Network::getNumaNode() const {
+        return device->numaNode;
     }
 
     /// Get the LID
     uint16_t Network::getLID() {
-        return context->queryPort(ibport).getLid();
+        return device->context->queryPort(port).getLid();
     }
 
     /// Get the GID
     ibv::Gid Network::getGID() {
-        return context->queryGid(ibport, 0);
+        return device->context->queryGid(port, 0);
+    }
+
+    size_t Network::getMtu() {
+        switch (device->context->queryPort(port).getActiveMtu()) {
+            case ibv::Mtu::_256:
+                return 256;
+            case ibv::Mtu::_512:
+                return 512;
+            case ibv::Mtu::_1024:
+                return 1024;
+            case ibv::Mtu::_2048:
+                return 2048;
+            case ibv::Mtu::_4096:
+                return 4096;
+        }
+        throw NetworkException("unknown active MTU");
     }
 
     /// Print the capabilities of the RDMA host channel adapter
     void Network::printCapabilities() {
         using Cap = ibv::device::CapabilityFlag;
         // Get a list of all devices
-        for (auto device : devices) {
+        for (auto ibDevice : device->devices) {
             // Open the device
-            auto context = device->open();
+            auto context = ibDevice->open();
 
             // Query device attributes
             const auto device_attr = context->queryAttributes();
@@ -182,15 +269,22 @@ namespace rdma {
 
     unique_ptr<ibv::memoryregion::MemoryRegion>
     Network::registerMr(void *addr, size_t length, initializer_list<ibv::AccessFlag> flags) {
-        return protectionDomain->registerMemoryRegion(addr, length, flags);
+        return device->protectionDomain->registerMemoryRegion(addr, length, flags);
+    }
+
+    unique_ptr<ibv::memoryregion::MemoryRegion>
+    Network::registerNumaLocalMr(void *addr, size_t length, initializer_list<ibv::AccessFlag> flags) {
+        // before registering, since pinned pages can't migrate anymore
+        l5::util::bindToNumaNode(addr, length, device->numaNode);
+        return registerMr(addr, length, flags);
     }
 
     CompletionQueuePair Network::newCompletionQueuePair() {
-        return CompletionQueuePair(*context);
+        return CompletionQueuePair(*device->context);
     }
 
     ibv::protectiondomain::ProtectionDomain &Network::getProtectionDomain() {
-        return *protectionDomain;
+        return *device->protectionDomain;
     }
 
     CompletionQueuePair &Network::getSharedCompletionQueue() {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include "CompletionQueuePair.hpp"
 
 namespace rdma {
@@ -17,7 +18,30 @@ namespace rdma {
 
     std::ostream &operator<<(std::ostream &os, const Address &address);
 
-    /// Abstracts a global rdma context
+    /// An opened Infiniband device with its protection domain, shared by all Networks of the process, that use it
+    struct Device {
+        /// The Infiniband devices
+        ibv::device::DeviceList devices;
+        /// The verbs context
+        std::unique_ptr<ibv::context::Context> context;
+        /// The global protection domain
+        std::unique_ptr<ibv::protectiondomain::ProtectionDomain> protectionDomain;
+        /// The NUMA node, the device is attached to, -1 if unknown
+        int numaNode = -1;
+
+        explicit Device(const std::string &name);
+
+        /**
+         * The process-wide instance of the named device, opened on first use and closed when the last Network
+         * releases it. An empty name selects the only device, or with several devices the one attached to the NUMA
+         * node of the calling thread.
+         */
+        static std::shared_ptr<Device> acquire(const std::string &name);
+    };
+
+    /// Abstracts a global rdma context. The device context and protection domain are shared by all Networks of the
+    /// process, so memory regions and queue pairs of different Networks live in the same protection domain. Completion
+    /// and shared receive queues stay per Network, so a transport only polls its own completions.
     class Network {
         friend class QueuePair;
 
@@ -25,14 +49,10 @@ namespace rdma {
         static constexpr uint32_t maxSge = 1;
 
         /// The port of the Infiniband device
-        static constexpr uint8_t ibport = 1;
+        const uint8_t port;
 
-        /// The Infiniband devices
-        ibv::device::DeviceList devices;
-        /// The verbs context
-        std::unique_ptr<ibv::context::Context> context;
-        /// The global protection domain
-        std::unique_ptr<ibv::protectiondomain::ProtectionDomain> protectionDomain;
+        /// Keeps the device open at least as long as the queues below
+        std::shared_ptr<Device> device;
 
         /// Shared Queues
         CompletionQueuePair sharedCompletionQueuePair;
@@ -40,14 +60,26 @@ namespace rdma {
         std::unique_ptr<ibv::srq::SharedReceiveQueue> sharedReceiveQueue;
 
     public:
+        /// Uses the device and port named by the environment variables L5RDMA_DEVICE and L5RDMA_PORT, if set.
+        /// Otherwise selects a device like Device::acquire and uses its first port
         Network();
 
+        explicit Network(const std::string &deviceName, uint8_t port = 1);
+
+        uint8_t getPort() const;
+
+        /// The NUMA node of the device, -1 if unknown. Buffers registered with registerNumaLocalMr prefer this node
+        int getNumaNode() const;
+
         /// Get the LID
         uint16_t getLID();
 
         /// Get the GID
         ibv::Gid getGID();
 
+        /// The active MTU of the port in bytes, i.e. the largest payload of a single packet
+        size_t getMtu();
+
         /// Print the capabilities of the RDMA host channel adapter
         void printCapabilities();
 
@@ -59,6 +91,11 @@ namespace rdma {
         std::unique_ptr<ibv::memoryregion::MemoryRegion>
         registerMr(void *addr, size_t length, std::initializer_list<ibv::AccessFlag> flags);
 
+        /// Register a new MemoryRegion for a buffer, that the transport allocated itself. Its (whole) pages prefer the
+        /// NUMA node of the device, user memory keeps its placement
+        std::unique_ptr<ibv::memoryregion::MemoryRegion>
+        registerNumaLocalMr(void *addr, size_t length, std::initializer_list<ibv::AccessFlag> flags);
+
         ibv::protectiondomain::ProtectionDomain& getProtectionDomain();
     };
 }
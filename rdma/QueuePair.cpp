@@ -15,7 +15,7 @@ namespace rdma {
 
     QueuePair::QueuePair(Network &network, ibv::queuepair::Type type, CompletionQueuePair &completionQueuePair,
                          ibv::srq::SharedReceiveQueue &receiveQueue)
-            : defaultPort(network.ibport), receiveQueue(receiveQueue) {
+            : defaultPort(network.port), receiveQueue(receiveQueue) {
         ibv::queuepair::InitAttributes queuePairAttributes{};
         queuePairAttributes.setContext(context);
         // CQ to be associated with the Send Queue (SQ)
@@ -35,7 +35,7 @@ namespace rdma {
         queuePairAttributes.setSignalAll(signalAll);
 
         // Create queue pair
-        qp = network.protectionDomain->createQueuePair(queuePairAttributes);
+        qp = network.device->protectionDomain->createQueuePair(queuePairAttributes);
     }
 
     uint32_t QueuePair::getQPN() {
@@ -0,0 +1,44 @@
+#include "RegistrationCache.h"
+#include "NetworkException.h"
+
+namespace rdma {
+    void RegistrationCache::add(const void *addr, size_t length) {
+        const auto begin = reinterpret_cast<uintptr_t>(addr);
+        if (registrations.count(begin) != 0) {
+            throw NetworkException("buffer is already registered");
+        }
+        // registering read-only memory for local writes fails, so that's no valid rendezvous destination anyways
+        auto mr = net.getProtectionDomain().registerMemoryRegion(const_cast<void *>(addr), length,
+                                                                 {ibv::AccessFlag::LOCAL_WRITE,
+                                                                  ibv::AccessFlag::REMOTE_READ});
+        registrations.emplace(begin, Registration{begin + length, std::move(mr)});
+    }
+
+    void RegistrationCache::remove(const void *addr) {
+        registrations.erase(reinterpret_cast<uintptr_t>(addr));
+    }
+
+    ibv::memoryregion::MemoryRegion *RegistrationCache::find(const void *addr, size_t length) const {
+        const auto begin = reinterpret_cast<uintptr_t>(addr);
+        // the last registration, that starts at or before addr
+        auto it = registrations.upper_bound(begin);
+        if (it == registrations.begin()) {
+            return nullptr;
+        }
+        --it;
+        if (begin + length > it->second.end) {
+            return nullptr;
+        }
+        return it->second.mr.get();
+    }
+
+    ibv::memoryregion::MemoryRegion &
+    RegistrationCache::findOrRegister(const void *addr, size_t length, std::initializer_list<ibv::AccessFlag> flags,
+                                      MemoryRegion &temporary) {
+        if (auto mr = find(addr, length)) {
+            return *mr;
+        }
+        temporary = net.getProtectionDomain().registerMemoryRegion(const_cast<void *>(addr), length, flags);
+        return *temporary;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef L5RDMA_REGISTRATIONCACHE_H
+#define L5RDMA_REGISTRATIONCACHE_H
+
+#include <cstdint>
+#include <map>
+#include "rdma/Network.hpp"
+
+namespace rdma {
+    /**
+     * Registrations of application buffers, e.g. the sources and destinations of rendezvous transfers.
+     * Buffers, that the application added, stay registered (for local writes and remote reads) until they are removed.
+     * Everything else is registered on demand, only for the duration of a single transfer.
+     * Other than Network::registerMr, this doesn't move the application's memory to the device's NUMA node.
+     * Registered memory is pinned: the application needs to remove a buffer, before it unmaps it, since a later mapping
+     * at the same address would silently use the old pages otherwise.
+     */
+    class RegistrationCache {
+        struct Registration {
+            uintptr_t end;
+            MemoryRegion mr;
+        };
+
+        Network &net;
+        /// By start address
+        std::map<uintptr_t, Registration> registrations;
+
+    public:
+        explicit RegistrationCache(Network &net) : net(net) {}
+
+        /// Keep [addr, addr + length) registered, until remove(addr)
+        void add(const void *addr, size_t length);
+
+        void remove(const void *addr);
+
+        /// The added registration, that covers [addr, addr + length), or nullptr
+        ibv::memoryregion::MemoryRegion *find(const void *addr, size_t length) const;
+
+        /// The added registration, that covers [addr, addr + length), otherwise a temporary registration with flags,
+        /// which is kept alive by temporary
+        ibv::memoryregion::MemoryRegion &
+        findOrRegister(const void *addr, size_t length, std::initializer_list<ibv::AccessFlag> flags,
+                       MemoryRegion &temporary);
+    };
+}
+
+#endif //L5RDMA_REGISTRATIONCACHE_H
@@ -30,6 +30,14 @@ void rdma::UcQueuePair::connect(const Address &address, uint8_t port) {
         ahAttributes.setSl(0);
         ahAttributes.setSrcPathBits(0);
         ahAttributes.setPortNum(port);
+        // see RcQueuePair::connect
+        if (address.gid.getInterfaceId()) {
+            ahAttributes.setIsGlobal(true);
+            ibv::GlobalRoute globalRoute{};
+            globalRoute.setHopLimit(1);
+            globalRoute.setDgid(address.gid);
+            ahAttributes.setGrh(globalRoute);
+        }
         attributes.setAhAttr(ahAttributes);
 
         qp->modify(attributes, {Mod::STATE, Mod::AV, Mod::PATH_MTU, Mod::DEST_QPN, Mod::RQ_PSN});
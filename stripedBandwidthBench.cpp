@@ -0,0 +1,101 @@
+#include "include/RdmaTransport.h"
+#include "include/StripedRdmaTransport.h"
+#include <thread>
+#include <util/doNotOptimize.h>
+#include <util/ycsb.h>
+#include "util/bench.h"
+
+using namespace l5::transport;
+
+static constexpr uint16_t port = 1234;
+static const char* ip = "127.0.0.1";
+
+constexpr size_t operator "" _k(unsigned long long i) { return i * 1024; }
+constexpr size_t operator "" _m(unsigned long long i) { return i * 1024 * 1024; }
+
+static constexpr auto printResults = []
+      (double workSize, auto avgTime, auto userPercent, auto systemPercent, auto totalPercent) {
+   std::cout << workSize / 1e6 << ", "
+             << avgTime << ", "
+             << (workSize / 1e6 / avgTime) << ", "
+             << userPercent << ", "
+             << systemPercent << ", "
+             << totalPercent << '\n';
+};
+
+/// A single large transfer from the server to the client, like in bandwidthBench
+template<class Server, class Client>
+void doRun(const std::string &name, bool isClient, std::string connection, size_t size) {
+   std::vector<uint8_t> testdata(size);
+
+   if (isClient) {
+      sleep(1);
+      auto client = Client();
+      for (int i = 0;; ++i) {
+         try {
+            client.connect(connection);
+            break;
+         } catch (...) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            if (i > 10) throw;
+         }
+      }
+
+      client.read(testdata.data(), size);
+      DoNotOptimize(testdata);
+      ClobberMemory();
+      // don't tear down the connection, before the server finished sending
+      client.write(uint8_t(1));
+   } else { // server
+      auto server = Server(connection);
+      server.accept();
+
+      RandomString rand;
+      rand.fill(size, reinterpret_cast<char*>(testdata.data()));
+
+      std::cout << name << ", " << std::flush;
+      bench(testdata.size(), [&] {
+         server.write(testdata.data(), testdata.size());
+         uint8_t done;
+         server.read(done);
+      }, printResults);
+   }
+}
+
+int main(int argc, char** argv) {
+   if (argc < 2) {
+      std::cout << "Usage: " << argv[0] << " <client / server> <(optional) 127.0.0.1>" << std::endl;
+      return -1;
+   }
+   const auto isClient = argv[1][0] == 'c';
+   if (argc > 2) {
+      ip = argv[2];
+   }
+
+   const auto connection = [&] {
+      if (isClient) {
+         return ip + std::string(":") + std::to_string(port);
+      } else {
+         return std::to_string(port);
+      }
+   }();
+
+   if (not isClient) std::cout << "connection, MB, time, MB/s, user, system, total\n";
+   for (const size_t size : {1_m, 16_m, 256_m, 1024_m}) {
+      doRun<RdmaTransportServer<>,
+            RdmaTransportClient<>
+      >("rdma", isClient, connection, size);
+      doRun<StripedRdmaTransportServer<1>,
+            StripedRdmaTransportClient<1>
+      >("striped 1", isClient, connection, size);
+      doRun<StripedRdmaTransportServer<2>,
+            StripedRdmaTransportClient<2>
+      >("striped 2", isClient, connection, size);
+      doRun<StripedRdmaTransportServer<4>,
+            StripedRdmaTransportClient<4>
+      >("striped 4", isClient, connection, size);
+      doRun<StripedRdmaTransportServer<8>,
+            StripedRdmaTransportClient<8>
+      >("striped 8", isClient, connection, size);
+   }
+}
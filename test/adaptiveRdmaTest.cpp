@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+#include <zconf.h>
+#include "include/AdaptiveTransport.h"
+
+using namespace std;
+using namespace l5::transport;
+
+constexpr size_t BUFFER_SIZE = 64 * 1024;
+/// Messages of different sizes, the last one larger than the ring, so it is split into several messages
+const vector<size_t> MESSAGE_SIZES = {1, 999, 1000, 1001, 5000, 10 * BUFFER_SIZE + 123};
+/// Reads in pieces, which match neither the messages, nor the ring size
+constexpr size_t PIECE_SIZE = 1000;
+const size_t TIMEOUT_IN_SECONDS = 5;
+
+static vector<uint8_t> testData(size_t size) {
+    vector<uint8_t> data(size);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i % 251);
+    }
+    return data;
+}
+
+template<class Transport>
+static void checkMode(const Transport &transport) {
+    if (transport.getMode() != AdaptiveMode::Rdma) {
+        throw runtime_error{"didn't upgrade to RDMA"};
+    }
+}
+
+int main() {
+    // both ends run on this host, which would upgrade to shared memory
+    setenv("L5RDMA_ADAPTIVE", "rdma", 1);
+
+    const auto serverPid = fork();
+    if (serverPid == 0) {
+        auto server = AdaptiveTransportServer<BUFFER_SIZE>("1236");
+        server.accept();
+        checkMode(server);
+        for (int round = 0; round < 2; ++round) {
+            for (const auto size : MESSAGE_SIZES) {
+                server.write(testData(size).data(), size);
+            }
+        }
+        // don't tear down the connection, before everything arrived
+        uint8_t done;
+        server.read(&done, sizeof(done));
+        return 0;
+    }
+
+    const auto clientPid = fork();
+    if (clientPid == 0) {
+        sleep(1); // server needs some time to start
+        auto client = AdaptiveTransportClient<BUFFER_SIZE>();
+        client.connect("127.0.0.1:1236");
+        checkMode(client);
+        for (const auto size : MESSAGE_SIZES) {
+            auto received = vector<uint8_t>(size);
+            for (size_t i = 0; i < size;) {
+                i += client.readSome(&received[i], min(PIECE_SIZE, size - i));
+            }
+            if (received != testData(size)) {
+                throw runtime_error{"received unexpected data"};
+            }
+        }
+        // reads, that cross the messages' boundaries
+        const auto total = accumulate(MESSAGE_SIZES.begin(), MESSAGE_SIZES.end(), size_t(0));
+        auto received = vector<uint8_t>(total);
+        for (size_t i = 0; i < total; i += PIECE_SIZE + 1) {
+            client.read(&received[i], min(PIECE_SIZE + 1, total - i));
+        }
+        size_t offset = 0;
+        for (const auto size : MESSAGE_SIZES) {
+            if (not equal(&received[offset], &received[offset] + size, testData(size).begin())) {
+                throw runtime_error{"received unexpected data"};
+            }
+            offset += size;
+        }
+        const uint8_t done = 1;
+        client.write(&done, sizeof(done));
+        return 0;
+    }
+
+    int serverStatus = 1;
+    int clientStatus = 1;
+    size_t secs = 0;
+    for (; secs < TIMEOUT_IN_SECONDS; ++secs, sleep(1)) {
+        auto serverTerminated = waitpid(serverPid, &serverStatus, WNOHANG) != 0;
+        auto clientTerminated = waitpid(clientPid, &clientStatus, WNOHANG) != 0;
+        if (serverTerminated && clientTerminated) {
+            break;
+        }
+    }
+
+    if (secs >= TIMEOUT_IN_SECONDS) {
+        std::cerr << "timeout" << std::endl;
+        kill(serverPid, SIGTERM);
+        kill(clientPid, SIGTERM);
+        return 1;
+    }
+
+    return serverStatus == 0 && clientStatus == 0 ? 0 : 1;
+}
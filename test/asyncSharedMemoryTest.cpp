@@ -0,0 +1,95 @@
+#include "include/AsyncTransport.h"
+#include "include/SharedMemoryTransport.h"
+#include "util/PollingExecutor.h"
+#include <array>
+#include <iostream>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace l5::transport;
+using l5::util::PollingExecutor;
+using l5::util::Task;
+
+const size_t CONNECTIONS = 8;
+const size_t MESSAGES = 4 * 1024;
+const size_t TIMEOUT_IN_SECONDS = 5;
+
+using Server = SharedMemoryTransportServer<64 * 1024>;
+using Client = SharedMemoryTransportClient<64 * 1024>;
+
+string socketName(size_t i) {
+    return "/tmp/asyncPingPong" + to_string(i);
+}
+
+Task pong(Server &server) {
+    array<uint8_t, 64> buffer{};
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        co_await asyncRead(server, buffer.data(), buffer.size());
+        co_await asyncWrite(server, buffer.data(), buffer.size());
+    }
+}
+
+Task ping(Client &client, size_t id) {
+    array<uint8_t, 64> data{};
+    array<uint8_t, 64> buffer{};
+    for (size_t i = 0; i < MESSAGES; ++i) {
+        data.fill(static_cast<uint8_t>(id + i));
+        co_await asyncWrite(client, data.data(), data.size());
+        co_await asyncRead(client, buffer.data(), buffer.size());
+        if (buffer != data) {
+            throw runtime_error{"received unexpected data"};
+        }
+    }
+}
+
+int main() {
+    const auto serverPid = fork();
+    if (serverPid == 0) {
+        vector<unique_ptr<Server>> servers;
+        for (size_t i = 0; i < CONNECTIONS; ++i) {
+            servers.push_back(make_unique<Server>(socketName(i)));
+        }
+        // all connections are driven from this single thread
+        auto executor = PollingExecutor();
+        for (auto &server : servers) {
+            server->accept();
+            executor.spawn(pong(*server));
+        }
+        executor.run();
+        return 0;
+    }
+
+    const auto clientPid = fork();
+    if (clientPid == 0) {
+        sleep(1); // server needs some time to start
+        vector<unique_ptr<Client>> clients;
+        auto executor = PollingExecutor();
+        for (size_t i = 0; i < CONNECTIONS; ++i) {
+            clients.push_back(make_unique<Client>());
+            clients.back()->connect(socketName(i));
+            executor.spawn(ping(*clients.back(), i));
+        }
+        executor.run();
+        return 0;
+    }
+
+    int serverStatus = 1;
+    int clientStatus = 1;
+    size_t secs = 0;
+    for (; secs < TIMEOUT_IN_SECONDS; ++secs, sleep(1)) {
+        auto serverTerminated = waitpid(serverPid, &serverStatus, WNOHANG) != 0;
+        auto clientTerminated = waitpid(clientPid, &clientStatus, WNOHANG) != 0;
+        if (serverTerminated && clientTerminated) {
+            break;
+        }
+    }
+
+    if (secs >= TIMEOUT_IN_SECONDS) {
+        std::cerr << "timeout" << std::endl;
+        kill(serverPid, SIGTERM);
+        kill(clientPid, SIGTERM);
+        return 1;
+    }
+
+    return serverStatus + clientStatus;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+#include <zconf.h>
+#include "include/RdmaTransport.h"
+
+using namespace std;
+using namespace l5::transport;
+
+/// A small ring, so each transfer wraps around it several times
+constexpr size_t BUFFER_SIZE = 64 * 1024;
+constexpr size_t TRANSFER_SIZE = 10 * BUFFER_SIZE + 123;
+/// Above the rendezvous threshold, so the receiver reads it straight from the sender's buffer
+constexpr size_t RENDEZVOUS_SIZE = 4 * 1024 * 1024 + 5;
+/// Reads and writes in pieces, which match neither each other nor the transport's chunks
+constexpr size_t PIECE_SIZE = 1000;
+const size_t TIMEOUT_IN_SECONDS = 5;
+
+static vector<uint8_t> testData(size_t size = TRANSFER_SIZE) {
+    vector<uint8_t> data(size);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i % 251);
+    }
+    return data;
+}
+
+template<class Transport>
+static void writeInPieces(Transport &transport, const vector<uint8_t> &data) {
+    for (size_t i = 0; i < data.size(); i += PIECE_SIZE) {
+        transport.write(&data[i], min(PIECE_SIZE, data.size() - i));
+    }
+}
+
+template<class Transport>
+static void readInPieces(Transport &transport, vector<uint8_t> &data) {
+    for (size_t i = 0; i < data.size(); i += PIECE_SIZE) {
+        transport.read(&data[i], min(PIECE_SIZE, data.size() - i));
+    }
+}
+
+static void check(const vector<uint8_t> &received) {
+    if (received != testData(received.size())) {
+        throw runtime_error{"received unexpected data"};
+    }
+}
+
+int main() {
+    const auto serverPid = fork();
+    if (serverPid == 0) {
+        auto server = RdmaTransportServer<BUFFER_SIZE>("1234");
+        server.accept();
+        // one large write, read in small pieces
+        server.write(testData().data(), TRANSFER_SIZE);
+        // many small writes, read at once
+        auto received = vector<uint8_t>(TRANSFER_SIZE);
+        server.read(received.data(), received.size());
+        check(received);
+
+        // rendezvous from a registered buffer, read in small pieces
+        const auto data = testData(RENDEZVOUS_SIZE);
+        server.registerBuffer(data.data(), data.size());
+        server.write(data.data(), data.size());
+        server.unregisterBuffer(data.data());
+        // rendezvous into a registered buffer
+        received = vector<uint8_t>(RENDEZVOUS_SIZE);
+        server.registerBuffer(received.data(), received.size());
+        server.read(received.data(), received.size());
+        server.unregisterBuffer(received.data());
+        check(received);
+        return 0;
+    }
+
+    const auto clientPid = fork();
+    if (clientPid == 0) {
+        sleep(1); // server needs some time to start
+        auto client = RdmaTransportClient<BUFFER_SIZE>();
+        for (int i = 0;; ++i) {
+            try {
+                client.connect("127.0.0.1:1234");
+                break;
+            } catch (...) {
+                this_thread::sleep_for(chrono::milliseconds(20));
+                if (i > 10) throw;
+            }
+        }
+        auto received = vector<uint8_t>(TRANSFER_SIZE);
+        readInPieces(client, received);
+        check(received);
+        writeInPieces(client, testData());
+
+        received = vector<uint8_t>(RENDEZVOUS_SIZE);
+        readInPieces(client, received);
+        check(received);
+        const auto data = testData(RENDEZVOUS_SIZE);
+        client.registerBuffer(data.data(), data.size());
+        client.write(data.data(), data.size());
+        client.unregisterBuffer(data.data());
+        return 0;
+    }
+
+    int serverStatus = 1;
+    int clientStatus = 1;
+    size_t secs = 0;
+    for (; secs < TIMEOUT_IN_SECONDS; ++secs, sleep(1)) {
+        auto serverTerminated = waitpid(serverPid, &serverStatus, WNOHANG) != 0;
+        auto clientTerminated = waitpid(clientPid, &clientStatus, WNOHANG) != 0;
+        if (serverTerminated && clientTerminated) {
+            break;
+        }
+    }
+
+    if (secs >= TIMEOUT_IN_SECONDS) {
+        std::cerr << "timeout" << std::endl;
+        kill(serverPid, SIGTERM);
+        kill(clientPid, SIGTERM);
+        return 1;
+    }
+
+    return serverStatus + clientStatus;
+}
@@ -0,0 +1,74 @@
+#include "include/SharedMemoryTransport.h"
+#include <iostream>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace l5::transport;
+
+/// A single page, so the sender fills the ring long before the receiver starts reading
+constexpr size_t BUFFER_SIZE = 4 * 1024;
+constexpr size_t TRANSFER_SIZE = 16 * BUFFER_SIZE;
+constexpr size_t PIECE_SIZE = 1000;
+const size_t TIMEOUT_IN_SECONDS = 5;
+
+static vector<uint8_t> testData() {
+    vector<uint8_t> data(TRANSFER_SIZE);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i % 251);
+    }
+    return data;
+}
+
+int main() {
+    const auto serverPid = fork();
+    if (serverPid == 0) {
+        auto server = SharedMemoryTransportServer<BUFFER_SIZE>("/tmp/flowControl");
+        server.accept();
+        const auto data = testData();
+        for (size_t i = 0; i < data.size(); i += PIECE_SIZE) {
+            server.write(&data[i], min(PIECE_SIZE, data.size() - i));
+        }
+        return 0;
+    }
+
+    const auto clientPid = fork();
+    if (clientPid == 0) {
+        sleep(1); // server needs some time to start
+        auto client = SharedMemoryTransportClient<BUFFER_SIZE>();
+        client.connect("/tmp/flowControl");
+        // a sender, that doesn't wait for free space, overwrites the unread data in the meantime
+        this_thread::sleep_for(chrono::milliseconds(200));
+        auto received = vector<uint8_t>(TRANSFER_SIZE);
+        for (size_t i = 0; i < received.size(); i += PIECE_SIZE) {
+            client.read(&received[i], min(PIECE_SIZE, received.size() - i));
+        }
+        if (received != testData()) {
+            std::cerr << "sender overwrote unread data" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    int serverStatus = 1;
+    int clientStatus = 1;
+    size_t secs = 0;
+    for (; secs < TIMEOUT_IN_SECONDS; ++secs, sleep(1)) {
+        auto serverTerminated = waitpid(serverPid, &serverStatus, WNOHANG) != 0;
+        auto clientTerminated = waitpid(clientPid, &clientStatus, WNOHANG) != 0;
+        if (serverTerminated && clientTerminated) {
+            break;
+        }
+    }
+
+    if (secs >= TIMEOUT_IN_SECONDS) {
+        std::cerr << "timeout" << std::endl;
+        kill(serverPid, SIGTERM);
+        kill(clientPid, SIGTERM);
+        return 1;
+    }
+
+    // the raw wait statuses, summed, would wrap around to an exit code of 0
+    return serverStatus == 0 && clientStatus == 0 ? 0 : 1;
+}
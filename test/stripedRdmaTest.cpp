@@ -0,0 +1,55 @@
+#include <future>
+#include <iostream>
+#include <sys/wait.h>
+#include <zconf.h>
+#include "apps/PingPong.h"
+#include "include/StripedRdmaTransport.h"
+
+using namespace std;
+using namespace l5::transport;
+
+const size_t MESSAGES = 1024;
+/// Several chunks per message, so every message is spread over all stripes
+const size_t DATA_SIZE = 1024 * 1024;
+const size_t TIMEOUT_IN_SECONDS = 5;
+
+int main() {
+    const auto serverPid = fork();
+    if (serverPid == 0) {
+        auto pong = Pong(make_transportServer<StripedRdmaTransportServer<>>("1234"), DATA_SIZE);
+        pong.start();
+        for (size_t i = 0; i < MESSAGES; ++i) {
+            pong.pong();
+        }
+        return 0;
+    }
+
+    const auto clientPid = fork();
+    if (clientPid == 0) {
+        sleep(1); // server needs some time to start
+        auto ping = Ping(make_transportClient<StripedRdmaTransportClient<>>(), "127.0.0.1:1234", DATA_SIZE);
+        for (size_t i = 0; i < MESSAGES; ++i) {
+            ping.ping();
+        }
+    }
+
+    int serverStatus = 1;
+    int clientStatus = 1;
+    size_t secs = 0;
+    for (; secs < TIMEOUT_IN_SECONDS; ++secs, sleep(1)) {
+        auto serverTerminated = waitpid(serverPid, &serverStatus, WNOHANG) != 0;
+        auto clientTerminated = waitpid(clientPid, &clientStatus, WNOHANG) != 0;
+        if (serverTerminated && clientTerminated) {
+            break;
+        }
+    }
+
+    if (secs >= TIMEOUT_IN_SECONDS) {
+        std::cerr << "timeout" << std::endl;
+        kill(serverPid, SIGTERM);
+        kill(clientPid, SIGTERM);
+        return 1;
+    }
+
+    return serverStatus + clientStatus;
+}
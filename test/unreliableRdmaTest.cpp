@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <sys/wait.h>
+#include <vector>
+#include <zconf.h>
+#include "apps/PingPong.h"
+#include "include/RdmaTransport.h"
+
+using namespace std;
+using namespace l5::transport;
+using namespace l5::datastructure;
+using namespace l5::util;
+
+const size_t MESSAGES = 4 * 1024; // ~ 1s, the local connection doesn't drop messages
+/// What the sender does, true for a message, which is dropped on purpose. The first message on the connection is
+/// dropped, and the drops are followed by several delivered messages, so these must not be skipped along with them
+const vector<bool> BURST = {true, false, true, false, false, true, false, false, false};
+/// Drops, while the receiver already waits
+const vector<bool> LIVE = {true, false, true, true, false};
+const size_t TIMEOUT_IN_SECONDS = 5;
+
+static size_t drops(const vector<bool> &sends) {
+    return static_cast<size_t>(std::count(sends.begin(), sends.end(), true));
+}
+
+/// Sends the messages 0, 1, 2, ..., dropping the ones marked in sends
+template<class Ring>
+static void send(Ring &ring, const vector<bool> &sends, size_t &next) {
+    for (const auto drop : sends) {
+        if (drop) {
+            ring.dropNextMessage();
+        }
+        ring.send(reinterpret_cast<const uint8_t *>(&next), sizeof(next));
+        ++next;
+    }
+}
+
+/// Expects the messages, that weren't dropped, in order
+template<class Ring>
+static void receive(Ring &ring, const vector<bool> &sends, size_t &next) {
+    for (const auto drop : sends) {
+        if (not drop) {
+            size_t received;
+            ring.receive(&received, sizeof(received));
+            if (received != next) {
+                throw runtime_error{"received " + to_string(received) + " instead of " + to_string(next)};
+            }
+        }
+        ++next;
+    }
+}
+
+static void dropSender() {
+    auto listenSock = Socket::create();
+    tcp::bind(listenSock, 1235);
+    tcp::listen(listenSock);
+    auto sock = tcp::accept(listenSock);
+    auto ring = UnreliableVirtualRDMARingBuffer(64 * 1024, sock);
+    size_t next = 0;
+    send(ring, BURST, next);
+    tcp::write(sock, uint8_t(1)); // the whole burst is in the receiver's ring, before it starts receiving
+    uint8_t ready;
+    tcp::read(sock, ready);
+    send(ring, LIVE, next);
+    tcp::read(sock, ready); // wait for the receiver, before tearing down the connection
+}
+
+static void dropReceiver() {
+    auto sock = Socket::create();
+    tcp::connect(sock, "127.0.0.1", 1235);
+    auto ring = UnreliableVirtualRDMARingBuffer(64 * 1024, sock);
+    uint8_t sent;
+    tcp::read(sock, sent);
+    size_t next = 0;
+    receive(ring, BURST, next);
+    tcp::write(sock, uint8_t(1));
+    receive(ring, LIVE, next);
+
+    if (statsEnabled && ring.stats().droppedMessages != drops(BURST) + drops(LIVE)) {
+        throw runtime_error{"counted " + to_string(ring.stats().droppedMessages) + " dropped messages"};
+    }
+    tcp::write(sock, uint8_t(1));
+}
+
+int main() {
+    vector<pid_t> pids;
+    pids.push_back(fork());
+    if (pids.back() == 0) {
+        auto pong = Pong(make_transportServer<UnreliableRdmaTransportServer<>>("1234"));
+        pong.start();
+        for (size_t i = 0; i < MESSAGES; ++i) {
+            pong.pong();
+        }
+        return 0;
+    }
+
+    pids.push_back(fork());
+    if (pids.back() == 0) {
+        sleep(1); // server needs some time to start
+        auto ping = Ping(make_transportClient<UnreliableRdmaTransportClient<>>(), "127.0.0.1:1234");
+        for (size_t i = 0; i < MESSAGES; ++i) {
+            ping.ping();
+        }
+        return 0;
+    }
+
+    pids.push_back(fork());
+    if (pids.back() == 0) {
+        dropSender();
+        return 0;
+    }
+
+    pids.push_back(fork());
+    if (pids.back() == 0) {
+        sleep(1); // server needs some time to start
+        dropReceiver();
+        return 0;
+    }
+
+    vector<int> statuses(pids.size(), 1);
+    vector<bool> terminated(pids.size(), false);
+    size_t secs = 0;
+    for (; secs < TIMEOUT_IN_SECONDS; ++secs, sleep(1)) {
+        for (size_t i = 0; i < pids.size(); ++i) {
+            terminated[i] = terminated[i] || waitpid(pids[i], &statuses[i], WNOHANG) != 0;
+        }
+        if (all_of(terminated.begin(), terminated.end(), [](bool t) { return t; })) {
+            break;
+        }
+    }
+
+    if (secs >= TIMEOUT_IN_SECONDS) {
+        std::cerr << "timeout" << std::endl;
+        for (const auto pid : pids) {
+            kill(pid, SIGTERM);
+        }
+        return 1;
+    }
+
+    return all_of(statuses.begin(), statuses.end(), [](int status) { return status == 0; }) ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#include "include/AdaptiveTransport.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+
+namespace l5 {
+namespace transport {
+namespace adaptive {
+using namespace std::string_literals;
+
+static bool rdmaAvailable() {
+   // rdma::Network uses any of the devices, unless L5RDMA_DEVICE names one
+   static const bool available = [] {
+      try {
+         ibv::device::DeviceList devices;
+         const auto name = std::string(std::getenv("L5RDMA_DEVICE") ? std::getenv("L5RDMA_DEVICE") : "");
+         return std::any_of(devices.begin(), devices.end(), [&](auto device) {
+            return name.empty() || name == device->getName();
+         });
+      } catch (...) {
+         return false;
+      }
+   }();
+   return available;
+}
+
+AdaptiveHello localHello() {
+   AdaptiveHello hello{};
+   std::array<char, 64> hostname{};
+   ::gethostname(hostname.data(), hostname.size() - 1);
+
+   std::string bootId;
+   std::ifstream("/proc/sys/kernel/random/boot_id") >> bootId;
+
+   const auto hostId = std::string(hostname.data()) + "/" + bootId;
+   std::strncpy(hello.hostId, hostId.c_str(), sizeof(hello.hostId) - 1);
+
+   const auto limit = std::string(std::getenv("L5RDMA_ADAPTIVE") ? std::getenv("L5RDMA_ADAPTIVE") : "");
+   if (not limit.empty() && limit != "rdma" && limit != "tcp") {
+      throw std::runtime_error("L5RDMA_ADAPTIVE should be rdma or tcp, not: "s + limit);
+   }
+   hello.sharedMemory = limit.empty();
+   hello.rdma = limit != "tcp" && rdmaAvailable();
+   return hello;
+}
+
+AdaptiveMode negotiate(const AdaptiveHello &local, const AdaptiveHello &remote) {
+   if (local.sharedMemory && remote.sharedMemory &&
+       std::strncmp(local.hostId, remote.hostId, sizeof(local.hostId)) == 0) {
+      return AdaptiveMode::SharedMemory;
+   }
+   if (local.rdma && remote.rdma) {
+      return AdaptiveMode::Rdma;
+   }
+   return AdaptiveMode::Tcp;
+}
+
+std::string domainSocketPath(uint16_t port) {
+   return "/tmp/l5rdma-adaptive-"s + std::to_string(port);
+}
+
+bool pollReadable(const util::Socket &sock) {
+   pollfd pollFd{};
+   pollFd.fd = sock.get();
+   pollFd.events = POLLIN;
+   const auto ret = ::poll(&pollFd, 1, 0);
+   if (ret < 0) {
+      throw std::runtime_error("Could not poll socket: "s + ::strerror(errno));
+   }
+   return (pollFd.revents & POLLIN) != 0;
+}
+} // namespace adaptive
+} // namespace transport
+} // namespace l5
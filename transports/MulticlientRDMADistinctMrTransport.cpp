@@ -53,6 +53,7 @@ size_t MulticlientRDMADistinctMrTransportServer::receive(void* whereTo, size_t m
                return i;
             }
          }
+         pollCounters.add(Stat::WaitSpins);
       }
    }();
 
@@ -69,6 +70,7 @@ size_t MulticlientRDMADistinctMrTransportServer::receive(void* whereTo, size_t m
 
    // reset the size to allow the next write
    *sizePtr = 0;
+   connections[client].counters.received(size);
    return client;
 }
 
@@ -94,22 +96,39 @@ void MulticlientRDMADistinctMrTransportServer::send(size_t receiverId, const uin
    *validityPtr = validity;
 
    con.answerWr.setLocalAddress(sendBuffer.getSlice(0, totalLength));
+   if (totalLength < 512) {
+      con.counters.add(Stat::InlinedWrs);
+   }
    // selective signaling needs to happen per queuepair / connection
    ++con.sendCounter;
    if (con.sendCounter % 1024 == 0) {
       setWrFlags(con.answerWr, true, totalLength < 512);
       con.qp.postWorkRequest(con.answerWr);
-      sharedCq->pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
+      const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+      while (con.counters.poll(sharedCq->pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
    } else {
       setWrFlags(con.answerWr, false, totalLength < 512);
       con.qp.postWorkRequest(con.answerWr);
    }
+   con.counters.sent(size);
 }
 
 void MulticlientRDMADistinctMrTransportServer::finishListen() {
    listenSock.close();
 }
 
+TransportStats MulticlientRDMADistinctMrTransportServer::stats() const {
+   auto result = pollCounters.snapshot();
+   for (const auto& con : connections) {
+      result += con.counters.snapshot();
+   }
+   return result;
+}
+
+TransportStats MulticlientRDMADistinctMrTransportServer::stats(size_t connectionId) const {
+   return connections.at(connectionId).counters.snapshot();
+}
+
 MulticlientRDMADistinctMrTransportClient::MulticlientRDMADistinctMrTransportClient()
    : sock(Socket::create()),
      net(),
@@ -165,14 +184,22 @@ void MulticlientRDMADistinctMrTransportClient::send(const uint8_t* data, size_t
    std::copy(data, data + size, payloadBegin);
    dataWr.setLocalAddress(sendBuffer.getSlice(0, dataWrSize));
    qp.postWorkRequest(dataWr);
-   cq.pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
+   counters.add(Stat::InlinedWrs);
+   const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+   while (counters.poll(cq.pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+   counters.sent(size);
 }
 
 size_t MulticlientRDMADistinctMrTransportClient::receive(void* whereTo, size_t maxSize) {
    size_t size;
-   do {
+   uint64_t spins = 0;
+   for (;; ++spins) {
       size = *reinterpret_cast<volatile size_t*>(receiveBuffer.data());
-   } while (size == 0 || *reinterpret_cast<volatile char*>(receiveBuffer.data() + sizeof(size_t) + size) != validity);
+      if (size != 0 && *reinterpret_cast<volatile char*>(receiveBuffer.data() + sizeof(size_t) + size) == validity) {
+         break;
+      }
+   }
+   counters.add(Stat::WaitSpins, spins);
    if (size > maxSize) {
       throw std::runtime_error("received message > maxSize");
    }
@@ -181,6 +208,7 @@ size_t MulticlientRDMADistinctMrTransportClient::receive(void* whereTo, size_t m
 
    std::copy(begin, end, reinterpret_cast<uint8_t*>(whereTo));
    *reinterpret_cast<volatile size_t*>(receiveBuffer.data()) = 0;
+   counters.received(size);
    return size;
 }
 } // namespace l5
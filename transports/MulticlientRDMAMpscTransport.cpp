@@ -0,0 +1,248 @@
+#include "include/MulticlientRDMAMpscTransport.h"
+#include "util/socket/tcp.h"
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <cstddef>
+
+namespace l5::transport {
+using namespace util;
+
+static auto uuidGenerator = boost::uuids::random_generator{};
+
+MulticlientRDMAMpscTransportServer::MulticlientRDMAMpscTransportServer(const std::string& port, size_t maxClients,
+                                                                       size_t ringSize)
+   : MAX_CLIENTS(maxClients),
+     ringSize(ringSize),
+     bitmask(ringSize - 1),
+     listenSock(Socket::create()),
+     net(),
+     sharedCq(&net.getSharedCompletionQueue()),
+     ring(mmapSharedRingBuffer(to_string(uuidGenerator()), ringSize, true)),
+     // Since we mapped twice the virtual memory, messages can be written across the end of the ring in one piece
+     ringMr(net.registerNumaLocalMr(ring.data.get(), ringSize * 2,
+                                    {ibv::AccessFlag::LOCAL_WRITE, ibv::AccessFlag::REMOTE_WRITE})),
+     positions(1, net, {ibv::AccessFlag::LOCAL_WRITE, ibv::AccessFlag::REMOTE_ATOMIC, ibv::AccessFlag::REMOTE_READ}),
+     sendBuffer(MAX_MESSAGESIZE, net, {}) {
+   const bool powerOfTwo = (ringSize != 0) && !(ringSize & (ringSize - 1));
+   if (not powerOfTwo) {
+      throw std::runtime_error{"ringSize should be a power of 2"};
+   }
+   connections.reserve(MAX_CLIENTS);
+   listen(std::stoi(port));
+}
+
+void MulticlientRDMAMpscTransportServer::listen(uint16_t port) {
+   tcp::bind(listenSock, port);
+   tcp::listen(listenSock);
+}
+
+void MulticlientRDMAMpscTransportServer::accept() {
+   const auto clientId = static_cast<uint32_t>(connections.size());
+
+   auto acced = tcp::accept(listenSock);
+
+   auto qp = rdma::RcQueuePair(net);
+
+   auto address = rdma::Address{net.getGID(), qp.getQPN(), net.getLID()};
+   tcp::write(acced, address);
+   tcp::read(acced, address);
+
+   tcp::write(acced, ringMr->getRemoteAddress());
+   tcp::write(acced, positions.getAddr().offset(offsetof(mpsc::RingPositions, tail)));
+   tcp::write(acced, positions.getAddr().offset(offsetof(mpsc::RingPositions, head)));
+   tcp::write(acced, static_cast<uint64_t>(ringSize));
+   tcp::write(acced, clientId);
+
+   auto receiveAddr = ibv::memoryregion::RemoteAddress();
+   tcp::read(acced, receiveAddr);
+
+   qp.connect(address);
+
+   auto answer = ibv::workrequest::Simple<ibv::workrequest::Write>();
+   answer.setLocalAddress(sendBuffer.getSlice());
+   answer.setRemoteAddress(receiveAddr);
+
+   connections.emplace_back(std::move(acced), std::move(qp), answer);
+}
+
+size_t MulticlientRDMAMpscTransportServer::receive(void* whereTo, size_t maxSize) {
+   size_t res;
+   receive([&](auto sender, auto begin, auto end) {
+      res = sender;
+      const auto size = static_cast<size_t>(std::distance(begin, end));
+      if (maxSize < size) {
+         // the message is dropped, consume releases its space anyways
+         throw std::runtime_error("received message > maxSize");
+      }
+      std::copy(begin, end, reinterpret_cast<uint8_t*>(whereTo));
+   });
+   return res;
+}
+
+void MulticlientRDMAMpscTransportServer::send(size_t receiverId, const uint8_t* data, size_t size) {
+   const auto totalLength = size + sizeof(size_t) + sizeof(validity);
+   if (totalLength > MAX_MESSAGESIZE) {
+      throw std::runtime_error("can't send messages > MAX_MESSAGESIZE");
+   }
+   if (receiverId >= connections.size()) {
+      throw std::runtime_error("no such connection");
+   }
+
+   auto& con = connections[receiverId];
+
+   auto sizePtr = reinterpret_cast<size_t*>(sendBuffer.data());
+   auto begin = sendBuffer.data() + sizeof(size_t);
+   std::copy(data, data + size, begin);
+   *sizePtr = size;
+   *(begin + size) = validity;
+
+   con.answerWr.setLocalAddress(sendBuffer.getSlice(0, totalLength));
+   const auto inlineMsg = totalLength <= con.qp.getMaxInlineSize();
+   if (inlineMsg) {
+      con.counters.add(Stat::InlinedWrs);
+   }
+   // the send buffer is reused right away, so wait for answers that aren't inlined
+   ++con.sendCounter;
+   if (con.sendCounter % 1024 == 0 || not inlineMsg) {
+      setWrFlags(con.answerWr, true, inlineMsg);
+      con.qp.postWorkRequest(con.answerWr);
+      const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+      while (con.counters.poll(sharedCq->pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+   } else {
+      setWrFlags(con.answerWr, false, inlineMsg);
+      con.qp.postWorkRequest(con.answerWr);
+   }
+   con.counters.sent(size);
+}
+
+void MulticlientRDMAMpscTransportServer::finishListen() {
+   listenSock.close();
+}
+
+TransportStats MulticlientRDMAMpscTransportServer::stats() const {
+   auto result = pollCounters.snapshot();
+   for (const auto& con : connections) {
+      result += con.counters.snapshot();
+   }
+   return result;
+}
+
+TransportStats MulticlientRDMAMpscTransportServer::stats(size_t connectionId) const {
+   return connections.at(connectionId).counters.snapshot();
+}
+
+MulticlientRDMAMpscTransportClient::MulticlientRDMAMpscTransportClient()
+   : sock(Socket::create()),
+     net(),
+     cq(net.getSharedCompletionQueue()),
+     qp(rdma::RcQueuePair(net)),
+     sendBuffer(mpsc::messageLength(MAX_MESSAGESIZE), net, {}),
+     receiveBuffer(MAX_MESSAGESIZE, net, {ibv::AccessFlag::LOCAL_WRITE, ibv::AccessFlag::REMOTE_WRITE}),
+     positions(2, net, {ibv::AccessFlag::LOCAL_WRITE}) {}
+
+void MulticlientRDMAMpscTransportClient::rdmaConnect() {
+   auto address = rdma::Address{net.getGID(), qp.getQPN(), net.getLID()};
+   tcp::write(sock, address);
+   tcp::read(sock, address);
+
+   tcp::read(sock, ringAddr);
+   tcp::read(sock, tailAddr);
+   tcp::read(sock, headAddr);
+   tcp::read(sock, ringSize);
+   tcp::read(sock, clientId);
+
+   tcp::write(sock, receiveBuffer.getAddr());
+
+   qp.connect(address);
+}
+
+void MulticlientRDMAMpscTransportClient::connect(std::string_view whereTo) {
+   const auto pos = whereTo.find(':');
+   if (pos == std::string::npos) {
+      throw std::runtime_error("usage: <0.0.0.0:port>");
+   }
+   const auto ip = std::string(whereTo.data(), pos);
+   const auto port = std::stoi(std::string(whereTo.begin() + pos + 1, whereTo.end()));
+   return connect(ip, port);
+}
+
+void MulticlientRDMAMpscTransportClient::connect(const std::string& ip, uint16_t port) {
+   tcp::connect(sock, ip, port);
+
+   rdmaConnect();
+}
+
+uint64_t MulticlientRDMAMpscTransportClient::reserve(size_t length) {
+   auto wr = ibv::workrequest::Simple<ibv::workrequest::AtomicFetchAdd>();
+   wr.setLocalAddress(positions.getSlice(0, sizeof(uint64_t)));
+   wr.setRemoteAddress(tailAddr);
+   wr.setAddValue(length);
+   wr.setSignaled();
+   qp.postWorkRequest(wr);
+   const auto opcode = ibv::workcompletion::Opcode::FETCH_ADD;
+   while (counters.poll(cq.pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+   return positions.data()[0];
+}
+
+void MulticlientRDMAMpscTransportClient::waitUntilFree(uint64_t start, size_t length) {
+   if (start + length - knownHead <= ringSize) {
+      return;
+   }
+   counters.add(Stat::SendStalls);
+   auto wr = ibv::workrequest::Simple<ibv::workrequest::Read>();
+   wr.setLocalAddress(positions.getSlice(sizeof(uint64_t), sizeof(uint64_t)));
+   wr.setRemoteAddress(headAddr);
+   wr.setSignaled();
+   do {
+      qp.postWorkRequest(wr);
+      const auto opcode = ibv::workcompletion::Opcode::RDMA_READ;
+      while (counters.poll(cq.pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+      knownHead = positions.data()[1];
+   } while (start + length - knownHead > ringSize);
+}
+
+void MulticlientRDMAMpscTransportClient::send(const uint8_t* data, size_t size) {
+   const auto length = mpsc::messageLength(size);
+   if (size > MAX_MESSAGESIZE || length > ringSize) {
+      throw std::runtime_error("can't send messages > MAX_MESSAGESIZE");
+   }
+
+   // the previous message is either inlined, or its write was waited for, so the send buffer is free
+   const auto header = mpsc::MessageHeader{static_cast<uint32_t>(size), clientId};
+   std::memcpy(sendBuffer.data(), &header, sizeof(header));
+   std::copy(data, data + size, sendBuffer.data() + sizeof(header));
+   std::memcpy(sendBuffer.data() + mpsc::validityOffset(size), &mpsc::validity, sizeof(mpsc::validity));
+
+   const auto start = reserve(length);
+   waitUntilFree(start, length);
+
+   auto wr = ibv::workrequest::Simple<ibv::workrequest::Write>();
+   wr.setLocalAddress(sendBuffer.getSlice(0, length));
+   wr.setRemoteAddress(ringAddr.offset(start & (ringSize - 1)));
+   const auto inlineMsg = length <= qp.getMaxInlineSize();
+   if (inlineMsg) {
+      wr.setInline();
+      qp.postWorkRequest(wr);
+      counters.add(Stat::InlinedWrs);
+   } else {
+      wr.setSignaled();
+      qp.postWorkRequest(wr);
+      const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+      while (counters.poll(cq.pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+   }
+   counters.sent(size);
+}
+
+size_t MulticlientRDMAMpscTransportClient::receive(void* whereTo, size_t maxSize) {
+   size_t size;
+   receive([&](auto begin, auto end) {
+      size = static_cast<size_t>(std::distance(begin, end));
+      if (size > maxSize) {
+         throw std::runtime_error("received message > maxSize");
+      }
+      std::copy(begin, end, reinterpret_cast<uint8_t*>(whereTo));
+   });
+   return size;
+}
+} // namespace l5::transport
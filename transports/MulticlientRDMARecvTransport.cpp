@@ -1,4 +1,5 @@
 #include "include/MulticlientRDMARecvTransport.h"
+#include "rdma/NetworkException.h"
 #include "util/socket/tcp.h"
 #include <cassert>
 
@@ -56,10 +57,18 @@ void MulticlientRDMARecvTransportServer::accept() {
 }
 
 size_t MulticlientRDMARecvTransportServer::receive(void* whereTo, size_t maxSize) {
-   auto wc = net.getSharedCompletionQueue().pollRecvWorkCompletionBlocking();
+   // like pollRecvWorkCompletionBlocking(), but counting the empty polls
+   auto wc = ibv::workcompletion::WorkCompletion();
+   while (sharedCq->getReceiveQueue().poll(1, &wc) == 0) {
+      pollCounters.add(Stat::EmptyCqPolls);
+   }
+   if (not wc) {
+      throw rdma::NetworkException("unexpected completion status: " + to_string(wc.getStatus()));
+   }
    // find out, which client this message came from
    auto client = qpnToConnection.at(wc.getQueuePairNumber());
    auto& connection = connections[client]; // TODO: could we use the ID to identify the client here? -> log ID?
+   connection.counters.add(Stat::Completions);
    // immediately replace the consumed receive request
    connection.qp.postRecvRequest(connection.recv);
 
@@ -73,6 +82,7 @@ size_t MulticlientRDMARecvTransportServer::receive(void* whereTo, size_t maxSize
    const auto end = begin + size;
 
    std::copy(begin, end, reinterpret_cast<uint8_t*>(whereTo));
+   connection.counters.received(size);
    return client;
 }
 
@@ -98,22 +108,39 @@ void MulticlientRDMARecvTransportServer::send(size_t receiverId, const uint8_t*
    *validityPtr = validity;
 
    con.answerWr.setLocalAddress(sendBuffer.getSlice(0, totalLength));
+   if (totalLength < 512) {
+      con.counters.add(Stat::InlinedWrs);
+   }
    // selective signaling needs to happen per queuepair / connection
    ++con.sendCounter;
    if (con.sendCounter % 1024 == 0) {
       setWrFlags(con.answerWr, true, totalLength < 512);
       con.qp.postWorkRequest(con.answerWr);
-      sharedCq->pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
+      const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+      while (con.counters.poll(sharedCq->pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
    } else {
       setWrFlags(con.answerWr, false, totalLength < 512);
       con.qp.postWorkRequest(con.answerWr);
    }
+   con.counters.sent(size);
 }
 
 void MulticlientRDMARecvTransportServer::finishListen() {
    listenSock.close();
 }
 
+TransportStats MulticlientRDMARecvTransportServer::stats() const {
+   auto result = pollCounters.snapshot();
+   for (const auto& con : connections) {
+      result += con.counters.snapshot();
+   }
+   return result;
+}
+
+TransportStats MulticlientRDMARecvTransportServer::stats(size_t connectionId) const {
+   return connections.at(connectionId).counters.snapshot();
+}
+
 MulticlientRDMARecvTransportClient::MulticlientRDMARecvTransportClient()
    : sock(Socket::create()),
      net(),
@@ -169,14 +196,22 @@ void MulticlientRDMARecvTransportClient::send(const uint8_t* data, size_t size)
    std::copy(data, data + size, payloadBegin);
    dataWr.setLocalAddress(sendBuffer.getSlice(0, dataWrSize));
    qp.postWorkRequest(dataWr);
-   cq.pollSendCompletionQueueBlocking(ibv::workcompletion::Opcode::RDMA_WRITE);
+   counters.add(Stat::InlinedWrs);
+   const auto opcode = ibv::workcompletion::Opcode::RDMA_WRITE;
+   while (counters.poll(cq.pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+   counters.sent(size);
 }
 
 size_t MulticlientRDMARecvTransportClient::receive(void* whereTo, size_t maxSize) {
    size_t size;
-   do {
+   uint64_t spins = 0;
+   for (;; ++spins) {
       size = *reinterpret_cast<volatile size_t*>(receiveBuffer.data());
-   } while (size == 0 || *reinterpret_cast<volatile char*>(receiveBuffer.data() + sizeof(size_t) + size) != validity);
+      if (size != 0 && *reinterpret_cast<volatile char*>(receiveBuffer.data() + sizeof(size_t) + size) == validity) {
+         break;
+      }
+   }
+   counters.add(Stat::WaitSpins, spins);
    if (size > maxSize) {
       throw std::runtime_error("received message > maxSize");
    }
@@ -185,6 +220,7 @@ size_t MulticlientRDMARecvTransportClient::receive(void* whereTo, size_t maxSize
 
    std::copy(begin, end, reinterpret_cast<uint8_t*>(whereTo));
    *reinterpret_cast<volatile size_t*>(receiveBuffer.data()) = 0;
+   counters.received(size);
    return size;
 }
 } // namespace l5
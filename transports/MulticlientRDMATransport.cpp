@@ -73,7 +73,7 @@ void MulticlientRDMATransportServer::send(size_t receiverId, const uint8_t *data
     if (totalLength > MAX_MESSAGESIZE) {
         throw std::runtime_error("can't send messages > MAX_MESSAGESIZE");
     }
-    if (receiverId > connections.size()) {
+    if (receiverId >= connections.size()) {
         throw std::runtime_error("no such connection");
     }
 
@@ -87,6 +87,18 @@ void MulticlientRDMATransportServer::finishListen() {
     listenSock.close();
 }
 
+TransportStats MulticlientRDMATransportServer::stats() const {
+    auto result = pollCounters.snapshot();
+    for (const auto &con : connections) {
+        result += con.counters.snapshot();
+    }
+    return result;
+}
+
+TransportStats MulticlientRDMATransportServer::stats(size_t connectionId) const {
+    return connections.at(connectionId).counters.snapshot();
+}
+
 MultiClientRDMATransportClient::MultiClientRDMATransportClient()
         : sock(Socket::create()),
           net(),
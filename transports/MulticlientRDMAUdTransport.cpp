@@ -0,0 +1,335 @@
+#include "include/MulticlientRDMAUdTransport.h"
+#include "rdma/NetworkException.h"
+#include "util/socket/tcp.h"
+#include <algorithm>
+#include <cstring>
+
+namespace l5::transport {
+using namespace util;
+
+namespace {
+/// Signal at least every n-th work request, so the send queue doesn't overflow
+constexpr size_t signalInterval = 1024;
+
+/// A received datagram, that passed the sanity checks
+struct Datagram {
+   ud::SegmentHeader header;
+   const uint8_t* payload;
+   size_t length;
+};
+
+template <class T>
+constexpr auto setWrFlags(T& wr, bool signaled, bool inlineMsg) {
+   if (signaled && inlineMsg) return wr.setFlags({ibv::workrequest::Flags::SIGNALED, ibv::workrequest::Flags::INLINE});
+   if (signaled) return wr.setFlags({ibv::workrequest::Flags::SIGNALED});
+   if (inlineMsg) return wr.setFlags({ibv::workrequest::Flags::INLINE});
+   return wr.setFlags({});
+}
+
+auto createAddressHandle(rdma::Network& net, const rdma::Address& address) {
+   ibv::ah::Attributes ahAttributes{};
+   ahAttributes.setIsGlobal(false);
+   ahAttributes.setDlid(address.lid);
+   ahAttributes.setSl(0);
+   ahAttributes.setSrcPathBits(0);
+   ahAttributes.setPortNum(net.getPort()); // local port
+   // RoCE needs the global route, see RcQueuePair::connect
+   if (address.gid.getInterfaceId()) {
+      ahAttributes.setIsGlobal(true);
+      ibv::GlobalRoute globalRoute{};
+      globalRoute.setHopLimit(1);
+      globalRoute.setDgid(address.gid);
+      ahAttributes.setGrh(globalRoute);
+   }
+
+   return net.getProtectionDomain().createAddressHandle(ahAttributes);
+}
+
+void postReceiveSlot(rdma::UdQueuePair& qp, rdma::RegisteredMemoryRegion<uint8_t>& receiveBuffer, size_t slotSize,
+                     size_t slot) {
+   auto slice = receiveBuffer.getSlice(slot * slotSize, slotSize);
+   auto recv = ibv::workrequest::Recv{};
+   recv.setId(slot);
+   recv.setSge(&slice, 1);
+   qp.postRecvRequest(recv);
+}
+
+std::optional<Datagram> parse(rdma::RegisteredMemoryRegion<uint8_t>& receiveBuffer, size_t slotSize,
+                              const ibv::workcompletion::WorkCompletion& wc) {
+   // the byte length includes the GRH
+   if (wc.getByteLen() < ud::GRH_SIZE + sizeof(ud::SegmentHeader)) {
+      return {};
+   }
+   const auto datagram = receiveBuffer.data() + wc.getId() * slotSize + ud::GRH_SIZE;
+   const auto length = wc.getByteLen() - ud::GRH_SIZE - sizeof(ud::SegmentHeader);
+   auto result = Datagram{{}, datagram + sizeof(ud::SegmentHeader), length};
+   std::memcpy(&result.header, datagram, sizeof(result.header));
+   if (result.header.messageSize > ud::MAX_MESSAGESIZE ||
+       result.header.offset + result.length > result.header.messageSize) {
+      return {};
+   }
+   return result;
+}
+
+/// Splits the message into datagrams of at most mtu bytes and posts them. The last datagram of a message is signaled
+/// and waited for, unless it is inlined, since the next message reuses the send buffer
+void postSegments(rdma::UdQueuePair& qp, rdma::CompletionQueuePair& cq,
+                  rdma::RegisteredMemoryRegion<uint8_t>& sendBuffer,
+                  ibv::workrequest::Simple<ibv::workrequest::Send>& wr, size_t& unsignaled, StatCounters& counters,
+                  size_t mtu, uint32_t sender, const uint8_t* data, size_t size) {
+   if (size > ud::MAX_MESSAGESIZE) {
+      throw std::runtime_error("can't send messages > MAX_MESSAGESIZE");
+   }
+   const auto payload = ud::segmentPayload(mtu);
+   const auto segments = std::max<size_t>(1, (size + payload - 1) / payload);
+   for (size_t i = 0; i < segments; ++i) {
+      const auto offset = i * payload;
+      const auto chunk = std::min(payload, size - offset);
+      const auto header = ud::SegmentHeader{sender, static_cast<uint32_t>(size), static_cast<uint32_t>(offset)};
+      const auto datagram = sendBuffer.data() + i * mtu;
+      std::memcpy(datagram, &header, sizeof(header));
+      std::copy(data + offset, data + offset + chunk, datagram + sizeof(header));
+
+      const auto length = sizeof(header) + chunk;
+      const auto inlineMsg = length <= qp.getMaxInlineSize();
+      const auto signaled = (i + 1 == segments && not inlineMsg) || ++unsignaled == signalInterval;
+      wr.setLocalAddress(sendBuffer.getSlice(i * mtu, length));
+      setWrFlags(wr, signaled, inlineMsg);
+      qp.postWorkRequest(wr);
+      if (inlineMsg) {
+         counters.add(Stat::InlinedWrs);
+      }
+      if (signaled) {
+         const auto opcode = ibv::workcompletion::Opcode::SEND;
+         while (counters.poll(cq.pollSendCompletionQueue(opcode)) == StatCounters::noCompletion);
+         unsignaled = 0;
+      }
+   }
+   counters.sent(size);
+}
+} // namespace
+
+std::optional<size_t> ud::Reassembly::add(const SegmentHeader& header, const uint8_t* payload, size_t length,
+                                          uint8_t* whereTo) {
+   if (header.offset == 0 && length == header.messageSize) {
+      // fits into a single datagram, no need to buffer
+      std::copy(payload, payload + length, whereTo);
+      return length;
+   }
+   if (header.offset == 0) {
+      data.resize(header.messageSize);
+      received = 0;
+   } else if (header.offset != received || data.size() != header.messageSize) {
+      // a segment was dropped, ignore the rest of this message
+      data.clear();
+      received = 0;
+      return {};
+   }
+   std::copy(payload, payload + length, data.data() + header.offset);
+   received += length;
+   if (received != data.size()) {
+      return {};
+   }
+   std::copy(data.begin(), data.end(), whereTo);
+   return data.size();
+}
+
+MulticlientRDMAUdTransportServer::MulticlientRDMAUdTransportServer(const std::string& port, size_t maxClients)
+   : MAX_CLIENTS(maxClients),
+     listenSock(Socket::create()),
+     net(),
+     mtu(net.getMtu()),
+     receiveSlots(std::clamp(2 * maxClients, 2 * ud::maxSegments(mtu), ud::MAX_RECEIVES)),
+     sharedCq(&net.getSharedCompletionQueue()),
+     qp(net),
+     receiveBuffer(receiveSlots * ud::receiveSlotSize(mtu), net, {ibv::AccessFlag::LOCAL_WRITE}),
+     sendBuffer(ud::SEND_BUFFER_SIZE, net, {}),
+     answerWr() {
+   // a UD queue pair has no remote, this only brings it to RTS
+   qp.connect(rdma::Address{net.getGID(), qp.getQPN(), net.getLID()});
+   for (size_t slot = 0; slot < receiveSlots; ++slot) {
+      postReceive(slot);
+   }
+   connections.reserve(MAX_CLIENTS);
+   listen(std::stoi(port));
+}
+
+void MulticlientRDMAUdTransportServer::listen(uint16_t port) {
+   tcp::bind(listenSock, port);
+   tcp::listen(listenSock);
+}
+
+void MulticlientRDMAUdTransportServer::postReceive(size_t slot) {
+   postReceiveSlot(qp, receiveBuffer, ud::receiveSlotSize(mtu), slot);
+}
+
+void MulticlientRDMAUdTransportServer::accept() {
+   if (connections.size() >= MAX_CLIENTS) {
+      throw std::runtime_error("can't accept more than maxClients");
+   }
+   const auto clientId = static_cast<uint32_t>(connections.size());
+
+   // the socket is only needed to exchange addresses, so the server doesn't keep a file descriptor per client
+   auto acced = tcp::accept(listenSock);
+
+   auto address = rdma::Address{net.getGID(), qp.getQPN(), net.getLID()};
+   tcp::write(acced, address);
+   tcp::read(acced, address);
+   // both sides send datagrams up to the smaller MTU, so they fit into the receive slots of the other side
+   auto clientMtu = static_cast<uint32_t>(mtu);
+   tcp::write(acced, clientMtu);
+   tcp::read(acced, clientMtu);
+
+   connections.emplace_back(createAddressHandle(net, address), address.qpn, std::min<size_t>(mtu, clientMtu));
+   // the client id is sent last, so the client doesn't send before we know its address
+   tcp::write(acced, clientId);
+}
+
+size_t MulticlientRDMAUdTransportServer::receive(void* whereTo, size_t maxSize) {
+   for (;;) {
+      auto wc = ibv::workcompletion::WorkCompletion();
+      while (sharedCq->getReceiveQueue().poll(1, &wc) == 0) {
+         pollCounters.add(Stat::EmptyCqPolls);
+      }
+      if (not wc) {
+         throw rdma::NetworkException("unexpected completion status: " + to_string(wc.getStatus()));
+      }
+      const auto slot = wc.getId();
+      const auto datagram = parse(receiveBuffer, ud::receiveSlotSize(mtu), wc);
+      // the source queue pair is set by the hardware, so a datagram can't pose as another client
+      if (not datagram || datagram->header.sender >= connections.size() ||
+          connections[datagram->header.sender].qpn != wc.getSourceQueuePair()) {
+         pollCounters.add(Stat::Completions);
+         postReceive(slot);
+         continue;
+      }
+      const auto client = datagram->header.sender;
+      auto& connection = connections[client];
+      connection.counters.add(Stat::Completions);
+      if (datagram->header.messageSize > maxSize) {
+         postReceive(slot);
+         throw std::runtime_error("received message > maxSize");
+      }
+
+      const auto size = connection.pending.add(datagram->header, datagram->payload, datagram->length,
+                                               reinterpret_cast<uint8_t*>(whereTo));
+      // immediately replace the consumed receive request
+      postReceive(slot);
+      if (size) {
+         connection.counters.received(*size);
+         return client;
+      }
+   }
+}
+
+void MulticlientRDMAUdTransportServer::send(size_t receiverId, const uint8_t* data, size_t size) {
+   if (receiverId >= connections.size()) {
+      throw std::runtime_error("no such connection");
+   }
+   auto& con = connections[receiverId];
+   answerWr.setUDAddressHandle(*con.addressHandle);
+   answerWr.setUDRemoteQueue(con.qpn, ud::QKEY);
+   postSegments(qp, *sharedCq, sendBuffer, answerWr, unsignaled, con.counters, con.mtu, 0, data, size);
+}
+
+void MulticlientRDMAUdTransportServer::finishListen() {
+   listenSock.close();
+}
+
+TransportStats MulticlientRDMAUdTransportServer::stats() const {
+   auto result = pollCounters.snapshot();
+   for (const auto& con : connections) {
+      result += con.counters.snapshot();
+   }
+   return result;
+}
+
+TransportStats MulticlientRDMAUdTransportServer::stats(size_t connectionId) const {
+   return connections.at(connectionId).counters.snapshot();
+}
+
+MulticlientRDMAUdTransportClient::MulticlientRDMAUdTransportClient()
+   : net(),
+     cq(net.getSharedCompletionQueue()),
+     qp(net),
+     sendBuffer(ud::SEND_BUFFER_SIZE, net, {}),
+     dataWr() {
+   qp.connect(rdma::Address{net.getGID(), qp.getQPN(), net.getLID()});
+}
+
+void MulticlientRDMAUdTransportClient::postReceive(size_t slot) {
+   postReceiveSlot(qp, *receiveBuffer, ud::receiveSlotSize(mtu), slot);
+}
+
+void MulticlientRDMAUdTransportClient::connect(std::string_view whereTo) {
+   const auto pos = whereTo.find(':');
+   if (pos == std::string::npos) {
+      throw std::runtime_error("usage: <0.0.0.0:port>");
+   }
+   const auto ip = std::string(whereTo.data(), pos);
+   const auto port = std::stoi(std::string(whereTo.begin() + pos + 1, whereTo.end()));
+   return connect(ip, port);
+}
+
+void MulticlientRDMAUdTransportClient::connect(const std::string& ip, uint16_t port) {
+   auto sock = Socket::create();
+   tcp::connect(sock, ip, port);
+
+   auto address = rdma::Address{net.getGID(), qp.getQPN(), net.getLID()};
+   tcp::write(sock, address);
+   tcp::read(sock, address);
+   auto serverMtu = static_cast<uint32_t>(net.getMtu());
+   tcp::write(sock, serverMtu);
+   tcp::read(sock, serverMtu);
+   mtu = std::min<size_t>(net.getMtu(), serverMtu);
+
+   // *first* post the receives, so the server's answers don't get swallowed
+   receiveSlots = 2 * ud::maxSegments(mtu);
+   receiveBuffer.emplace(receiveSlots * ud::receiveSlotSize(mtu), net,
+                         std::initializer_list<ibv::AccessFlag>{ibv::AccessFlag::LOCAL_WRITE});
+   for (size_t slot = 0; slot < receiveSlots; ++slot) {
+      postReceive(slot);
+   }
+   tcp::read(sock, clientId);
+
+   serverQpn = address.qpn;
+   serverAddressHandle = createAddressHandle(net, address);
+   dataWr.setUDAddressHandle(*serverAddressHandle);
+   dataWr.setUDRemoteQueue(serverQpn, ud::QKEY);
+}
+
+void MulticlientRDMAUdTransportClient::send(const uint8_t* data, size_t size) {
+   postSegments(qp, cq, sendBuffer, dataWr, unsignaled, counters, mtu, clientId, data, size);
+}
+
+size_t MulticlientRDMAUdTransportClient::receive(void* whereTo, size_t maxSize) {
+   for (;;) {
+      auto wc = ibv::workcompletion::WorkCompletion();
+      while (cq.getReceiveQueue().poll(1, &wc) == 0) {
+         counters.add(Stat::EmptyCqPolls);
+      }
+      if (not wc) {
+         throw rdma::NetworkException("unexpected completion status: " + to_string(wc.getStatus()));
+      }
+      counters.add(Stat::Completions);
+      const auto slot = wc.getId();
+      const auto datagram = parse(*receiveBuffer, ud::receiveSlotSize(mtu), wc);
+      if (not datagram || wc.getSourceQueuePair() != serverQpn) {
+         postReceive(slot);
+         continue;
+      }
+      if (datagram->header.messageSize > maxSize) {
+         postReceive(slot);
+         throw std::runtime_error("received message > maxSize");
+      }
+
+      const auto size = pending.add(datagram->header, datagram->payload, datagram->length,
+                                    reinterpret_cast<uint8_t*>(whereTo));
+      postReceive(slot);
+      if (size) {
+         counters.received(*size);
+         return *size;
+      }
+   }
+}
+} // namespace l5::transport
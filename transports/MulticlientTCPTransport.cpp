@@ -34,11 +34,25 @@ void MulticlientTCPTransportServer::accept() {
     p.fd = connections.back().get();
     p.events = POLLIN;
     pollFds.push_back(p);
+    counters.emplace_back("multiclient tcp server");
 }
 
 void MulticlientTCPTransportServer::send(size_t receiverId, const uint8_t *data, size_t size) {
     assert(receiverId < connections.size());
     tcp::write(connections[receiverId], data, size);
+    counters[receiverId].sent(size);
+}
+
+TransportStats MulticlientTCPTransportServer::stats() const {
+    auto result = TransportStats();
+    for (const auto &connection : counters) {
+        result += connection.snapshot();
+    }
+    return result;
+}
+
+TransportStats MulticlientTCPTransportServer::stats(size_t connectionId) const {
+    return counters.at(connectionId).snapshot();
 }
 
 size_t MulticlientTCPTransportServer::receive(void *whereTo, size_t maxSize) {
@@ -59,8 +73,12 @@ size_t MulticlientTCPTransportServer::receive(void *whereTo, size_t maxSize) {
             }
         }
     }();
-    ::recv(readable->fd, whereTo, maxSize, 0);
-    return static_cast<size_t>(std::distance(pollFds.begin(), readable));
+    const auto received = ::recv(readable->fd, whereTo, maxSize, 0);
+    const auto connectionId = static_cast<size_t>(std::distance(pollFds.begin(), readable));
+    if (received > 0) {
+        counters[connectionId].received(static_cast<size_t>(received));
+    }
+    return connectionId;
 }
 
 MulticlientTCPTransportClient::MulticlientTCPTransportClient() : socket(Socket::create()) {
@@ -90,10 +108,12 @@ void MulticlientTCPTransportClient::connect(std::string_view whereTo) {
 
 void MulticlientTCPTransportClient::send(const uint8_t *data, size_t size) {
     tcp::write(socket, data, size);
+    counters.sent(size);
 }
 
 void MulticlientTCPTransportClient::receive(void *whereTo, size_t maxSize) {
-    return tcp::read(socket, whereTo, maxSize);
+    tcp::read(socket, whereTo, maxSize);
+    counters.received(maxSize);
 }
 } // namespace transport
 } // namespace l5
@@ -0,0 +1,186 @@
+#include "Affinity.h"
+#include <cstdint>
+#include <cstdlib>
+#include <numa.h>
+#include <numaif.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace l5 {
+namespace util {
+namespace {
+/// Parses a single CPU list like "0-7,16-23"
+std::vector<int> parseCpuList(std::string_view list) {
+   std::vector<int> result;
+   while (not list.empty()) {
+      const auto comma = list.find(',');
+      const auto item = std::string(list.substr(0, comma));
+      list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+      if (item.empty()) {
+         continue;
+      }
+
+      size_t parsed = 0;
+      const auto first = std::stoi(item, &parsed);
+      auto last = first;
+      if (parsed < item.size()) {
+         if (item[parsed] != '-') {
+            throw std::runtime_error{"invalid CPU list: " + item};
+         }
+         last = std::stoi(item.substr(parsed + 1));
+      }
+      if (first < 0 || last < first) {
+         throw std::runtime_error{"invalid CPU range: " + item};
+      }
+      for (auto cpu = first; cpu <= last; ++cpu) {
+         result.push_back(cpu);
+      }
+   }
+   return result;
+}
+} // namespace
+
+int currentNumaNode() {
+   if (numa_available() < 0) {
+      return 0;
+   }
+   const auto cpu = sched_getcpu();
+   if (cpu < 0) {
+      return 0;
+   }
+   const auto node = numa_node_of_cpu(cpu);
+   return node < 0 ? 0 : node;
+}
+
+bool bindToNumaNode(void *addr, size_t length, int node) {
+   if (node < 0 || numa_available() < 0 || node > numa_max_node()) {
+      return false;
+   }
+   static const auto pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+   const auto begin = (reinterpret_cast<uintptr_t>(addr) + pageSize - 1) & ~(pageSize - 1);
+   const auto end = (reinterpret_cast<uintptr_t>(addr) + length) & ~(pageSize - 1);
+   if (begin >= end) {
+      return false;
+   }
+
+   auto nodemask = numa_allocate_nodemask();
+   numa_bitmask_setbit(nodemask, static_cast<unsigned>(node));
+   const auto res = mbind(reinterpret_cast<void *>(begin), end - begin, MPOL_PREFERRED, nodemask->maskp,
+                          nodemask->size + 1, MPOL_MF_MOVE);
+   numa_bitmask_free(nodemask);
+   return res == 0;
+}
+
+bool pinCurrentThread(int cpu) {
+   if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return false;
+   }
+   cpu_set_t cpuset;
+   CPU_ZERO(&cpuset);
+   CPU_SET(cpu, &cpuset);
+   return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+}
+
+Spread parseSpread(std::string_view name) {
+   if (name == "none") return Spread::None;
+   if (name == "cores") return Spread::Cores;
+   if (name == "nodes") return Spread::Nodes;
+   throw std::runtime_error{"unknown thread placement: " + std::string(name) + ", expected none, cores or nodes"};
+}
+
+Topology::Topology(std::vector<std::vector<int>> cpusOfNode) : cpusOfNode(std::move(cpusOfNode)) {
+   if (this->cpusOfNode.empty()) {
+      throw std::runtime_error{"topology without CPUs"};
+   }
+   for (const auto &cpus : this->cpusOfNode) {
+      if (cpus.empty()) {
+         throw std::runtime_error{"topology with an empty NUMA node"};
+      }
+   }
+}
+
+Topology Topology::discover() {
+   std::vector<std::vector<int>> nodes;
+   if (numa_available() < 0) {
+      nodes.emplace_back();
+      for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+         nodes.back().push_back(static_cast<int>(cpu));
+      }
+      return Topology(std::move(nodes));
+   }
+
+   // only consider the CPUs we may run on, e.g. within a cpuset
+   auto allowed = numa_allocate_cpumask();
+   numa_sched_getaffinity(0, allowed);
+   auto nodeCpus = numa_allocate_cpumask();
+   for (int node = 0; node <= numa_max_node(); ++node) {
+      if (numa_node_to_cpus(node, nodeCpus) != 0) {
+         continue;
+      }
+      std::vector<int> cpus;
+      for (int cpu = 0; cpu < numa_num_possible_cpus(); ++cpu) {
+         const auto bit = static_cast<unsigned>(cpu);
+         if (numa_bitmask_isbitset(nodeCpus, bit) && numa_bitmask_isbitset(allowed, bit)) {
+            cpus.push_back(cpu);
+         }
+      }
+      if (not cpus.empty()) {
+         nodes.push_back(std::move(cpus));
+      }
+   }
+   numa_bitmask_free(nodeCpus);
+   numa_bitmask_free(allowed);
+   return Topology(std::move(nodes));
+}
+
+Topology Topology::parse(std::string_view description) {
+   std::vector<std::vector<int>> nodes;
+   while (not description.empty()) {
+      const auto semicolon = description.find(';');
+      nodes.push_back(parseCpuList(description.substr(0, semicolon)));
+      description = semicolon == std::string_view::npos ? std::string_view() : description.substr(semicolon + 1);
+   }
+   return Topology(std::move(nodes));
+}
+
+Topology Topology::fromEnvironment() {
+   const auto description = std::getenv("L5RDMA_TOPOLOGY");
+   return description == nullptr ? discover() : parse(description);
+}
+
+int Topology::cpuFor(size_t thread, Spread spread) const {
+   switch (spread) {
+      case Spread::None:
+         return -1;
+      case Spread::Cores: {
+         size_t cpuCount = 0;
+         for (const auto &cpus : cpusOfNode) cpuCount += cpus.size();
+         auto index = thread % cpuCount;
+         for (const auto &cpus : cpusOfNode) {
+            if (index < cpus.size()) {
+               return cpus[index];
+            }
+            index -= cpus.size();
+         }
+         return -1; // unreachable
+      }
+      case Spread::Nodes: {
+         const auto &cpus = cpusOfNode[thread % cpusOfNode.size()];
+         return cpus[(thread / cpusOfNode.size()) % cpus.size()];
+      }
+   }
+   return -1;
+}
+
+void Topology::pin(size_t thread, Spread spread) const {
+   const auto cpu = cpuFor(thread, spread);
+   if (cpu >= 0 && not pinCurrentThread(cpu)) {
+      throw std::runtime_error{"could not pin thread " + std::to_string(thread) + " to CPU " + std::to_string(cpu)};
+   }
+}
+} // namespace util
+} // namespace l5
@@ -0,0 +1,68 @@
+#ifndef L5RDMA_AFFINITY_H
+#define L5RDMA_AFFINITY_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace l5 {
+namespace util {
+/// The NUMA node of the CPU, the calling thread currently runs on. 0 without NUMA support
+int currentNumaNode();
+
+/**
+ * Prefer a NUMA node for the memory in [addr, addr + length), and migrate pages, that were already touched elsewhere.
+ * When the node runs out of memory, new pages fall back to the other nodes. Only whole pages are affected, so
+ * neighbouring objects on the first and last page keep their placement. Pinned (e.g. registered) pages can't migrate.
+ * This is a placement hint: it does nothing for node < 0 or without NUMA support. Returns if the policy was set.
+ * E.g. for a WraparoundBuffer of size bytes: bindToNumaNode(buffer.data.get(), size * 2, node)
+ */
+bool bindToNumaNode(void *addr, size_t length, int node);
+
+/// Pin the calling thread to a single CPU, so it doesn't migrate away from its memory and NIC. Returns if it worked
+bool pinCurrentThread(int cpu);
+
+/// How to place the threads of a benchmark
+enum class Spread {
+   /// Leave the placement to the scheduler
+   None,
+   /// One thread per core, filling up one NUMA node before using the next
+   Cores,
+   /// Round robin over the NUMA nodes
+   Nodes,
+};
+
+/// "none", "cores" or "nodes"
+Spread parseSpread(std::string_view name);
+
+/// Which CPUs belong to which NUMA node
+class Topology {
+   std::vector<std::vector<int>> cpusOfNode;
+
+   public:
+   explicit Topology(std::vector<std::vector<int>> cpusOfNode);
+
+   /// The usable CPUs of this machine, with one entry per NUMA node, that has any
+   static Topology discover();
+
+   /// Parses a description like "0-7,16-23;8-15,24-31": the CPU lists (as in /sys) of each node, separated by ';'
+   static Topology parse(std::string_view description);
+
+   /// The description in the environment variable L5RDMA_TOPOLOGY if set, discover() otherwise
+   static Topology fromEnvironment();
+
+   size_t nodeCount() const { return cpusOfNode.size(); }
+
+   const std::vector<int> &cpus(size_t node) const { return cpusOfNode.at(node); }
+
+   /// The CPU for the thread with the given index, wrapping around when there are more threads than CPUs.
+   /// -1 for Spread::None
+   int cpuFor(size_t thread, Spread spread) const;
+
+   /// Pin the calling thread, as the thread with the given index
+   void pin(size_t thread, Spread spread) const;
+};
+} // namespace util
+} // namespace l5
+
+#endif //L5RDMA_AFFINITY_H
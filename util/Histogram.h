@@ -0,0 +1,131 @@
+#ifndef L5RDMA_HISTOGRAM_H
+#define L5RDMA_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+/**
+ * HDR style histogram for latencies in nanoseconds (or any other unsigned value).
+ * Values are counted in log-linear buckets: each power of two range is split into 2^subBucketBits linear sub buckets,
+ * so the relative error of any reported value is below 2^-subBucketBits (< 1%), for all values from 1ns to hours,
+ * using a fixed ~60KB of counters instead of storing all samples.
+ * Each thread should record into its own histogram: record() only uses relaxed loads and stores, no atomic
+ * read-modify-write, but other threads may still read or merge() a histogram while it is being recorded to.
+ */
+class Histogram {
+   static constexpr unsigned subBucketBits = 7;
+   static constexpr uint64_t subBuckets = 1u << subBucketBits;
+   static constexpr size_t indexCount = (64 - subBucketBits + 1) * subBuckets;
+
+   std::vector<std::atomic<uint64_t>> counts = std::vector<std::atomic<uint64_t>>(indexCount);
+   std::atomic<uint64_t> total{0};
+   std::atomic<uint64_t> sum{0};
+   std::atomic<uint64_t> minimum{std::numeric_limits<uint64_t>::max()};
+   std::atomic<uint64_t> maximum{0};
+
+   static size_t indexOf(uint64_t value) {
+      if (value < subBuckets) {
+         return value;
+      }
+      const auto exponent = 63u - static_cast<unsigned>(__builtin_clzll(value));
+      const auto shift = exponent - subBucketBits;
+      return (shift + 1) * subBuckets + ((value >> shift) - subBuckets);
+   }
+
+   /// Largest value, that is counted in index
+   static uint64_t highestValueOf(size_t index) {
+      if (index < subBuckets) {
+         return index;
+      }
+      const auto shift = index / subBuckets - 1;
+      const auto mantissa = subBuckets + index % subBuckets;
+      return ((mantissa + 1) << shift) - 1;
+   }
+
+   /// Single writer increment, no need for a locked instruction
+   static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+   }
+
+   public:
+   Histogram() = default;
+
+   Histogram(Histogram &&other) noexcept : Histogram() { merge(other); }
+
+   void record(uint64_t value) {
+      add(counts[indexOf(value)], 1);
+      add(total, 1);
+      add(sum, value);
+      if (value < minimum.load(std::memory_order_relaxed)) minimum.store(value, std::memory_order_relaxed);
+      if (value > maximum.load(std::memory_order_relaxed)) maximum.store(value, std::memory_order_relaxed);
+   }
+
+   /// Add all values of other. Not thread safe with concurrent records to *this
+   void merge(const Histogram &other) {
+      for (size_t i = 0; i < indexCount; ++i) {
+         const auto count = other.counts[i].load(std::memory_order_relaxed);
+         if (count != 0) {
+            add(counts[i], count);
+         }
+      }
+      add(total, other.total.load(std::memory_order_relaxed));
+      add(sum, other.sum.load(std::memory_order_relaxed));
+      minimum.store(std::min(min(), other.min()), std::memory_order_relaxed);
+      maximum.store(std::max(max(), other.max()), std::memory_order_relaxed);
+   }
+
+   uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+   uint64_t min() const { return minimum.load(std::memory_order_relaxed); }
+
+   uint64_t max() const { return maximum.load(std::memory_order_relaxed); }
+
+   double mean() const { return count() == 0 ? 0.0 : static_cast<double>(sum.load()) / static_cast<double>(count()); }
+
+   /// Smallest recorded value, that is greater or equal to percent % of all recorded values (within the precision)
+   uint64_t percentile(double percent) const {
+      const auto recorded = count();
+      if (recorded == 0) {
+         return 0;
+      }
+      const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(percent / 100.0 * static_cast<double>(recorded) +
+                                                                    0.5));
+      uint64_t seen = 0;
+      for (size_t i = 0; i < indexCount; ++i) {
+         seen += counts[i].load(std::memory_order_relaxed);
+         if (seen >= rank) {
+            return std::min(highestValueOf(i), max());
+         }
+      }
+      return max();
+   }
+
+   /// Column names matching printSummary
+   static const char *summaryHeader() { return "p50, p99, p99.9, max"; }
+
+   /// Print p50, p99, p99.9 and max as CSV columns, each value divided by unit (e.g. 1e3 for ns -> us)
+   void printSummary(std::ostream &out, double unit = 1.0) const {
+      for (const auto percent : {50.0, 99.0, 99.9}) {
+         out << static_cast<double>(percentile(percent)) / unit << ", ";
+      }
+      out << static_cast<double>(max()) / unit;
+   }
+
+   /// Print the distribution as "percentile, value" CSV lines, with exponentially finer steps towards the tail
+   void printPercentiles(std::ostream &out, double unit = 1.0) const {
+      out << "percentile, value\n";
+      for (double missing = 100.0; missing > 0.001; missing /= 2) {
+         for (int step = 0; step < 5; ++step) {
+            const auto percent = 100.0 - missing * (1.0 - step / 10.0);
+            out << percent << ", " << static_cast<double>(percentile(percent)) / unit << '\n';
+         }
+      }
+      out << 100.0 << ", " << static_cast<double>(max()) / unit << '\n';
+   }
+};
+
+#endif //L5RDMA_HISTOGRAM_H
@@ -0,0 +1,186 @@
+#ifndef L5RDMA_OPENLOOP_H
+#define L5RDMA_OPENLOOP_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+#include "util/Histogram.h"
+
+namespace l5 {
+namespace util {
+enum class ArrivalProcess {
+   Constant,
+   Poisson,
+};
+
+/// Intended send times of an open-loop load, with constant or exponentially distributed inter-arrival times
+class ArrivalSchedule {
+   using Clock = std::chrono::steady_clock;
+
+   ArrivalProcess process;
+   double meanNanoseconds;
+   std::mt19937_64 generator;
+   std::exponential_distribution<double> exponential{1.0};
+   double offset = 0; // ns since start, as double to not accumulate rounding errors
+   Clock::time_point start;
+
+   public:
+   ArrivalSchedule(double ratePerSecond, ArrivalProcess process, uint64_t seed = 42) :
+         process(process), meanNanoseconds(1e9 / ratePerSecond), generator(seed) {}
+
+   void begin(Clock::time_point startTime) {
+      start = startTime;
+      offset = 0;
+   }
+
+   /// Intended send time of the next request
+   Clock::time_point peek() const {
+      return start + std::chrono::nanoseconds(static_cast<int64_t>(offset));
+   }
+
+   Clock::time_point pop() {
+      const auto result = peek();
+      offset += process == ArrivalProcess::Poisson ? exponential(generator) * meanNanoseconds : meanNanoseconds;
+      return result;
+   }
+};
+
+struct OpenLoopResult {
+   /// Time from the first intended send to the last reply
+   double seconds;
+   /// Requests, that could not be sent at their intended time, since all lanes were busy
+   size_t delayed;
+};
+
+/**
+ * Open-loop load generator: issues count requests at the times given by schedule, independent of the replies, and
+ * records the latency from the *intended* send time to the reply (in ns). So queueing in front of a busy server is
+ * part of the measured latency, instead of silently lowering the offered load like in closed-loop benchmarks
+ * (coordinated omission).
+ * Requests are spread over the lanes, each lane is a connection that answers its requests in order. Lanes provide:
+ *    bool trySend()    - issue one request, returns false if the lane can't take another one right now
+ *    bool tryReceive() - consume one reply, returns false if there is none yet
+ * Requests that are due while all lanes are busy are queued, and still measured from their intended time.
+ */
+template<typename Lane>
+OpenLoopResult runOpenLoop(std::vector<Lane> &lanes, ArrivalSchedule &schedule, size_t count, Histogram &latencies) {
+   using Clock = std::chrono::steady_clock;
+   auto inFlight = std::vector<std::deque<Clock::time_point>>(lanes.size());
+   auto backlog = std::deque<Clock::time_point>();
+   size_t scheduled = 0;
+   size_t completed = 0;
+   size_t delayed = 0;
+   size_t delayedInBacklog = 0; // already counted as delayed
+   size_t nextLane = 0;
+
+   const auto start = Clock::now();
+   schedule.begin(start);
+   while (completed < count) {
+      auto now = Clock::now();
+      while (scheduled < count && schedule.peek() <= now) {
+         backlog.push_back(schedule.pop());
+         ++scheduled;
+      }
+
+      // round robin over the lanes, so no single connection queues up everything
+      for (size_t tried = 0; not backlog.empty() && tried < lanes.size(); ++tried) {
+         const auto lane = nextLane;
+         nextLane = (nextLane + 1) % lanes.size();
+         if (lanes[lane].trySend()) {
+            inFlight[lane].push_back(backlog.front());
+            backlog.pop_front();
+            if (delayedInBacklog > 0) --delayedInBacklog;
+            tried = 0;
+         }
+      }
+      delayed += backlog.size() - delayedInBacklog;
+      delayedInBacklog = backlog.size();
+
+      bool idle = true;
+      for (size_t lane = 0; lane < lanes.size(); ++lane) {
+         while (not inFlight[lane].empty() && lanes[lane].tryReceive()) {
+            now = Clock::now();
+            latencies.record(static_cast<uint64_t>(
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         now - inFlight[lane].front()).count()));
+            inFlight[lane].pop_front();
+            ++completed;
+            idle = false;
+         }
+      }
+
+      // give the CPU away, if there is nothing to do for a while
+      if (idle && backlog.empty() && completed == scheduled && scheduled < count &&
+          schedule.peek() - now > std::chrono::microseconds(50)) {
+         std::this_thread::yield();
+      }
+   }
+   const auto end = Clock::now();
+   return {std::chrono::duration<double>(end - start).count(), delayed};
+}
+
+/// Lane for one-to-one transports with readable / writable (i.e. the ring buffers), pipelines up to window requests
+template<typename Client, typename Request, typename Response>
+class PipelinedLane {
+   Client *client;
+   size_t window;
+   size_t outstanding = 0;
+   Request request{};
+   Response response{};
+
+   public:
+   PipelinedLane(Client &client, size_t window) : client(&client), window(window) {}
+
+   bool trySend() {
+      if (outstanding == window || not client->writable(sizeof(Request))) {
+         return false;
+      }
+      client->write(request);
+      ++outstanding;
+      return true;
+   }
+
+   bool tryReceive() {
+      if (outstanding == 0 || not client->readable(sizeof(Response))) {
+         return false;
+      }
+      client->read(response);
+      --outstanding;
+      return true;
+   }
+};
+
+/// Lane for a multi-client transport connection, which only supports one outstanding request
+template<typename Client, typename Request>
+class MultiClientLane {
+   Client *client;
+   bool outstanding = false;
+   Request request{};
+
+   public:
+   explicit MultiClientLane(Client &client) : client(&client) {}
+
+   bool trySend() {
+      if (outstanding) {
+         return false;
+      }
+      client->write(request);
+      outstanding = true;
+      return true;
+   }
+
+   bool tryReceive() {
+      if (not outstanding) {
+         return false;
+      }
+      outstanding = not client->tryReceive([](const uint8_t *, const uint8_t *) {});
+      return not outstanding;
+   }
+};
+} // namespace util
+} // namespace l5
+
+#endif //L5RDMA_OPENLOOP_H
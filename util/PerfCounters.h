@@ -0,0 +1,123 @@
+#ifndef L5RDMA_PERFCOUNTERS_H
+#define L5RDMA_PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <linux/perf_event.h>
+#include <ostream>
+#include <string_view>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static constexpr double perfNotAvailable = std::numeric_limits<double>::quiet_NaN();
+
+/// Hardware counters of one benchmark run, normalized per message (or whatever unit the work size is in)
+struct PerfCounters {
+   double cycles = perfNotAvailable;
+   double instructions = perfNotAvailable;
+   double llcMisses = perfNotAvailable;
+   double dtlbMisses = perfNotAvailable;
+   double contextSwitches = perfNotAvailable;
+};
+
+/**
+ * perf_event_open based counters for cycles, instructions, LLC misses, dTLB misses and context switches.
+ * Only enabled, when the environment variable L5RDMA_PERF is set (and not "0"), since it needs a permissive
+ * kernel.perf_event_paranoid and costs some overhead for starting threads.
+ * Counts the creating thread and all threads it starts afterwards. Unavailable events are reported as NaN.
+ */
+class PerfEvents {
+   static constexpr size_t eventCount = 5;
+   std::array<int, eventCount> fds{};
+   std::array<double, eventCount> totals{};
+
+   static int open(uint32_t type, uint64_t config) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = type;
+      attr.config = config;
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+   }
+
+   static constexpr uint64_t cacheMiss(uint64_t cache) {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8u) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16u);
+   }
+
+   /// Counter value, scaled up, if the kernel had to multiplex the counters
+   static double read(int fd) {
+      uint64_t values[3] = {};
+      if (fd < 0 || ::read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+         return perfNotAvailable;
+      }
+      return static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+   }
+
+   public:
+   static bool enabled() {
+      const auto env = std::getenv("L5RDMA_PERF");
+      return env != nullptr && std::string_view(env) != "" && std::string_view(env) != "0";
+   }
+
+   PerfEvents() {
+      fds = {open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+             open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS),
+             open(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL)),
+             open(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)),
+             open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES)};
+   }
+
+   ~PerfEvents() {
+      for (const auto fd : fds) {
+         if (fd >= 0) ::close(fd);
+      }
+   }
+
+   PerfEvents(const PerfEvents &) = delete;
+
+   PerfEvents &operator=(const PerfEvents &) = delete;
+
+   void start() {
+      for (const auto fd : fds) {
+         if (fd < 0) continue;
+         ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+         ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+   }
+
+   /// Stop counting and add the counts of this run to the totals
+   void stop() {
+      for (size_t i = 0; i < eventCount; ++i) {
+         if (fds[i] < 0) continue;
+         ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+         totals[i] += read(fds[i]);
+      }
+   }
+
+   /// Totals of all runs, divided by work
+   PerfCounters normalized(double work) const {
+      const auto get = [&](size_t i) { return fds[i] < 0 ? perfNotAvailable : totals[i] / work; };
+      return PerfCounters{get(0), get(1), get(2), get(3), get(4)};
+   }
+};
+
+/// Additional CSV column names, if the counters are enabled
+inline const char *perfHeader() {
+   return PerfEvents::enabled() ? ", cycles, instructions, LLC misses, dTLB misses, context switches" : "";
+}
+
+/// Print the counters as additional CSV columns, if they are enabled
+inline void printPerfColumns(std::ostream &out, const PerfCounters &perf) {
+   if (PerfEvents::enabled()) {
+      out << ", " << perf.cycles << ", " << perf.instructions << ", " << perf.llcMisses << ", " << perf.dtlbMisses
+          << ", " << perf.contextSwitches;
+   }
+}
+
+#endif //L5RDMA_PERFCOUNTERS_H
@@ -0,0 +1,72 @@
+#include "PollingExecutor.h"
+#include "util/busywait.h"
+
+namespace l5 {
+namespace util {
+PollingExecutor::~PollingExecutor() {
+   // every unfinished task is parked somewhere, since we are single threaded
+   for (auto pollable : parked) {
+      pollable->waiting.destroy();
+   }
+}
+
+void PollingExecutor::resume(Task::Handle handle) {
+   handle.resume();
+   if (not handle.done()) {
+      return; // parked again
+   }
+
+   auto exception = std::move(handle.promise().exception);
+   handle.destroy();
+   --alive;
+   if (exception) {
+      std::rethrow_exception(exception);
+   }
+}
+
+void PollingExecutor::spawn(Task task) {
+   auto handle = task.release();
+   handle.promise().executor = this;
+   ++alive;
+   resume(handle);
+}
+
+void PollingExecutor::park(Pollable& pollable) {
+   parked.push_back(&pollable);
+}
+
+size_t PollingExecutor::pollOnce() {
+   size_t resumed = 0;
+   // resumed tasks might park new operations, so iterate by index and swap-remove the ready ones
+   for (size_t i = 0; i < parked.size();) {
+      auto pollable = parked[i];
+      if (pollable->ready()) {
+         parked[i] = parked.back();
+         parked.pop_back();
+         ++resumed;
+         resume(pollable->waiting);
+      } else {
+         ++i;
+      }
+   }
+   return resumed;
+}
+
+bool PollingExecutor::poll() {
+   pollOnce();
+   return alive > 0;
+}
+
+void PollingExecutor::run() {
+   // back off like niceWait, when none of the parked operations make progress
+   int idle = 0;
+   while (alive > 0) {
+      if (pollOnce() > 0) {
+         idle = 0;
+      } else {
+         yield(idle++);
+      }
+   }
+}
+} // namespace util
+} // namespace l5
@@ -0,0 +1,114 @@
+#ifndef L5RDMA_POLLINGEXECUTOR_H
+#define L5RDMA_POLLINGEXECUTOR_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace l5 {
+namespace util {
+class PollingExecutor;
+
+/**
+ * Fire-and-forget coroutine, driven by a PollingExecutor.
+ * A Task starts suspended and only runs once it is spawned on an executor, which then owns the coroutine frame.
+ * Tasks can't be awaited themselves, they only co_await leaf operations (see include/AsyncTransport.h)
+ */
+class Task {
+   public:
+   struct promise_type {
+      PollingExecutor* executor = nullptr;
+      std::exception_ptr exception;
+
+      Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+
+      /// stay suspended after finishing, so the executor can check for exceptions and destroy the frame
+      std::suspend_always final_suspend() noexcept { return {}; }
+
+      void return_void() noexcept {}
+
+      void unhandled_exception() noexcept { exception = std::current_exception(); }
+   };
+
+   using Handle = std::coroutine_handle<promise_type>;
+
+   Task(const Task&) = delete;
+
+   Task& operator=(const Task&) = delete;
+
+   Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+   Task& operator=(Task&& other) noexcept {
+      std::swap(handle, other.handle);
+      return *this;
+   }
+
+   ~Task() {
+      if (handle) handle.destroy();
+   }
+
+   private:
+   friend class PollingExecutor;
+
+   explicit Task(Handle handle) : handle(handle) {}
+
+   Handle release() { return std::exchange(handle, nullptr); }
+
+   Handle handle;
+};
+
+/// Base class for everything a Task can be parked on. ready() is called repeatedly and must not block
+struct Pollable {
+   Task::Handle waiting;
+
+   virtual bool ready() = 0;
+
+   protected:
+   ~Pollable() = default;
+};
+
+/**
+ * Single threaded executor, that busy polls all parked operations (rings, completion queues, ...) and resumes the
+ * waiting coroutine as soon as its operation can complete without blocking.
+ * This way, one core can drive many concurrent connections / requests without a thread per connection.
+ */
+class PollingExecutor {
+   std::vector<Pollable*> parked;
+   size_t alive = 0;
+
+   void resume(Task::Handle handle);
+
+   /// Poll all parked operations once and return how many coroutines were resumed
+   size_t pollOnce();
+
+   public:
+   PollingExecutor() = default;
+
+   PollingExecutor(const PollingExecutor&) = delete;
+
+   PollingExecutor& operator=(const PollingExecutor&) = delete;
+
+   ~PollingExecutor();
+
+   /// Take ownership of the task and run it until its first suspension
+   void spawn(Task task);
+
+   /// Park the waiting coroutine of pollable, until pollable.ready() returns true
+   void park(Pollable& pollable);
+
+   /// Poll all parked operations once and resume the ready ones. Returns, if there are still unfinished tasks
+   bool poll();
+
+   /// Drive all spawned tasks to completion. Rethrows the first exception escaping a task
+   void run();
+
+   /// Number of unfinished tasks
+   size_t size() const { return alive; }
+};
+} // namespace util
+} // namespace l5
+
+#endif //L5RDMA_POLLINGEXECUTOR_H
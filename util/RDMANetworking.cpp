@@ -14,13 +14,17 @@ static void exchangeQPNAndConnect(const Socket &sock, rdma::Network &network, rd
     queuePair.connect(addr);
 }
 
-RDMANetworking::RDMANetworking(const Socket &sock) :
+template<typename QueuePair>
+BasicRDMANetworking<QueuePair>::BasicRDMANetworking(const Socket &sock) :
         completionQueue(network.newCompletionQueuePair()),
         queuePair(network, completionQueue) {
     tcp::setBlocking(sock); // just set the socket to block for our setup.
     exchangeQPNAndConnect(sock, network, queuePair);
 }
 
+template struct BasicRDMANetworking<rdma::RcQueuePair>;
+template struct BasicRDMANetworking<rdma::UcQueuePair>;
+
 void
 receiveAndSetupRmr(const Socket &sock, ibv::memoryregion::RemoteAddress &buffer,
                    ibv::memoryregion::RemoteAddress &readPos) {
@@ -2,21 +2,27 @@
 #define L5RDMA_RDMANETWORKING_H
 
 #include "rdma/RcQueuePair.h"
+#include "rdma/UcQueuePair.h"
 #include "rdma/Network.hpp"
 #include "rdma/CompletionQueuePair.hpp"
 
 namespace l5 {
 namespace util {
 class Socket;
-struct RDMANetworking {
+/// Network, completion queue and a connected queue pair. Instantiated for reliable (rdma::RcQueuePair) and
+/// unreliable (rdma::UcQueuePair) connections
+template<typename QueuePair>
+struct BasicRDMANetworking {
     rdma::Network network;
     rdma::CompletionQueuePair completionQueue;
-    rdma::RcQueuePair queuePair;
+    QueuePair queuePair;
 
     /// Exchange the basic RDMA connection info for the network and queues
-    explicit RDMANetworking(const Socket &sock);
+    explicit BasicRDMANetworking(const Socket &sock);
 };
 
+using RDMANetworking = BasicRDMANetworking<rdma::RcQueuePair>;
+
 struct RmrInfo {
     uint32_t bufferKey;
     uint32_t readPosKey;
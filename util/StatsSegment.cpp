@@ -0,0 +1,96 @@
+#include "StatsSegment.h"
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include "util/virtualMemory.h"
+
+namespace l5 {
+namespace util {
+namespace {
+/// The stats segment of this process, if it publishes its statistics
+class StatsPublisher {
+   ShmMapping<uint8_t> segment;
+   StatsSlot *slots = nullptr;
+
+   public:
+   StatsPublisher() {
+      if (not statsPublishingEnabled()) {
+         return;
+      }
+      const auto name = statsSegmentName(getpid());
+      shm_unlink(name.c_str()); // left over by a crashed process, that had the same pid
+      try {
+         segment = malloc_shared<uint8_t>(name, statsSegmentSize(statsSlotCount), nullptr, true);
+      } catch (const std::runtime_error &e) {
+         std::cerr << "could not publish statistics: " << e.what() << std::endl;
+         return;
+      }
+
+      auto header = new(segment.data.get()) StatsSegmentHeader{};
+      header->slotCount = statsSlotCount;
+      header->pid = getpid();
+      slots = reinterpret_cast<StatsSlot *>(segment.data.get() + sizeof(StatsSlot));
+      for (size_t i = 0; i < statsSlotCount; ++i) {
+         new(&slots[i]) StatsSlot{};
+      }
+      header->magic.store(statsSegmentMagic(), std::memory_order_release);
+   }
+
+   CounterBlock *acquire(std::string_view name) {
+      if (slots == nullptr) {
+         return nullptr;
+      }
+      for (size_t i = 0; i < statsSlotCount; ++i) {
+         auto &slot = slots[i];
+         auto expected = static_cast<uint32_t>(StatsSlot::Free);
+         if (slot.state.load(std::memory_order_relaxed) != StatsSlot::Free ||
+             not slot.state.compare_exchange_strong(expected, StatsSlot::Claimed)) {
+            continue;
+         }
+         const auto length = std::min(name.size(), sizeof(slot.name) - 1);
+         std::fill(std::copy_n(name.begin(), length, slot.name), std::end(slot.name), '\0');
+         for (auto &value : slot.counters.values) {
+            value.store(0, std::memory_order_relaxed);
+         }
+         slot.generation.store(slot.generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+         slot.state.store(StatsSlot::Used, std::memory_order_release);
+         return &slot.counters;
+      }
+      return nullptr; // all slots in use, count privately
+   }
+
+   /// Returns false, if the block is not part of the segment
+   bool release(CounterBlock *block) {
+      if (slots == nullptr) {
+         return false;
+      }
+      const auto address = reinterpret_cast<uintptr_t>(block);
+      const auto begin = reinterpret_cast<uintptr_t>(slots);
+      if (address < begin || address >= begin + statsSlotCount * sizeof(StatsSlot)) {
+         return false;
+      }
+      slots[(address - begin) / sizeof(StatsSlot)].state.store(StatsSlot::Free, std::memory_order_release);
+      return true;
+   }
+};
+
+StatsPublisher &publisher() {
+   static StatsPublisher instance;
+   return instance;
+}
+} // namespace
+
+CounterBlock *acquireCounters(std::string_view name) {
+   if (const auto block = publisher().acquire(name)) {
+      return block;
+   }
+   return new CounterBlock();
+}
+
+void releaseCounters(CounterBlock *block) {
+   if (not publisher().release(block)) {
+      delete block;
+   }
+}
+} // namespace util
+} // namespace l5
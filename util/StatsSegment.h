@@ -0,0 +1,73 @@
+#ifndef L5RDMA_STATSSEGMENT_H
+#define L5RDMA_STATSSEGMENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include "util/TransportStats.h"
+
+namespace l5 {
+namespace util {
+/**
+ * Layout of the named shared memory segment /l5rdma-stats.<pid>, in which a process publishes the counters of all its
+ * connections, so l5stat can watch a running process from the outside.
+ * Each connection's CounterBlock directly lives in one of the slots, so publishing costs nothing but the relaxed
+ * stores the counters do anyways.
+ * Publishing is enabled with the environment variable L5RDMA_STATS_SHM (and needs a build with L5RDMA_STATS).
+ */
+struct StatsSegmentHeader {
+   /// The version suffix changes with the layout of the counters
+   static constexpr char expectedMagic[8] = {'L', '5', 'S', 'T', 'A', 'T', '0', '2'};
+   /// Written last, so readers never see a half initialized segment
+   std::atomic<uint64_t> magic;
+   uint32_t slotCount;
+   int32_t pid;
+};
+
+/// Counters of one connection, and what it is
+struct alignas(64) StatsSlot {
+   enum State : uint32_t {
+      Free,
+      Claimed,
+      Used,
+   };
+   std::atomic<uint32_t> state;
+   /// Incremented on every reuse of the slot, so readers can tell a new connection from the previous one
+   std::atomic<uint32_t> generation;
+   char name[56];
+   CounterBlock counters;
+};
+
+static constexpr size_t statsSlotCount = 1024;
+static constexpr auto statsSegmentPrefix = "l5rdma-stats.";
+
+inline std::string statsSegmentName(pid_t pid) {
+   return "/" + std::string(statsSegmentPrefix) + std::to_string(pid);
+}
+
+inline size_t statsSegmentSize(size_t slotCount) {
+   return sizeof(StatsSlot) + slotCount * sizeof(StatsSlot); // the header takes the place of one slot
+}
+
+inline const StatsSlot *statsSlots(const StatsSegmentHeader *header) {
+   return reinterpret_cast<const StatsSlot *>(reinterpret_cast<const uint8_t *>(header) + sizeof(StatsSlot));
+}
+
+inline uint64_t statsSegmentMagic() {
+   uint64_t magic;
+   std::memcpy(&magic, StatsSegmentHeader::expectedMagic, sizeof(magic));
+   return magic;
+}
+
+inline bool statsPublishingEnabled() {
+   const auto env = std::getenv("L5RDMA_STATS_SHM");
+   return statsEnabled && env != nullptr && std::string_view(env) != "" && std::string_view(env) != "0";
+}
+} // namespace util
+} // namespace l5
+
+#endif //L5RDMA_STATSSEGMENT_H
@@ -0,0 +1,30 @@
+#ifndef L5RDMA_TRACEPOINTS_H
+#define L5RDMA_TRACEPOINTS_H
+
+/**
+ * Static (USDT) tracepoints in the transport hot paths, compiled in with cmake -DL5RDMA_USDT=ON, which needs
+ * sys/sdt.h (systemtap-sdt-dev). Most phases have a *_begin and *_end probe, tracers timestamp each hit, so per message
+ * timelines can be reconstructed. A probe that is not attached is a single nop, the arguments only need to be
+ * available in a register or on the stack. Without L5RDMA_USDT, the probes (and their arguments) vanish completely.
+ *
+ * Probes of the provider "l5rdma":
+ *    rdma_send_work_begin(message), rdma_send_work_end(message, size)     the doWork callback of a zero-copy send
+ *    rdma_send_wait_begin(message), rdma_send_wait_end(message)           waiting for space in the remote buffer
+ *    rdma_post_begin(message, size), rdma_post_end(message)               postWorkRequest of the message
+ *    rdma_receive_spin_begin(readPos), rdma_receive_spin_end(readPos, size)   the validity spin of a receive
+ *    multiclient_poll_begin(clients), multiclient_poll_end(sender)        the door bell scan of a multi-client receive
+ *
+ * e.g. the latency distribution of posting work requests:
+ *    bpftrace -e 'usdt:./p2pBench:l5rdma:rdma_post_begin { @start[tid] = nsecs; }
+ *                 usdt:./p2pBench:l5rdma:rdma_post_end /@start[tid]/ { @post = hist(nsecs - @start[tid]); }'
+ * or all probes with perf:
+ *    perf buildid-cache --add ./p2pBench && perf record -e 'sdt_l5rdma:*' ./p2pBench client 64
+ */
+#ifdef L5RDMA_USDT
+#include <sys/sdt.h>
+#define L5_TRACE(probe, ...) STAP_PROBEV(l5rdma, probe, __VA_ARGS__)
+#else
+#define L5_TRACE(probe, ...) do {} while (false)
+#endif
+
+#endif //L5RDMA_TRACEPOINTS_H
@@ -0,0 +1,181 @@
+#ifndef L5RDMA_TRANSPORTSTATS_H
+#define L5RDMA_TRANSPORTSTATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string_view>
+#include <utility>
+
+namespace l5 {
+namespace util {
+#ifdef L5RDMA_STATS
+static constexpr bool statsEnabled = true;
+#else
+static constexpr bool statsEnabled = false;
+#endif
+
+/// Snapshot of the counters of one connection (or the sum of several connections)
+struct TransportStats {
+   uint64_t messagesSent = 0;
+   uint64_t bytesSent = 0;
+   uint64_t messagesReceived = 0;
+   uint64_t bytesReceived = 0;
+   /// Sends that found the remote buffer full and had to wait for the receiver
+   uint64_t sendStalls = 0;
+   /// Busy wait iterations without progress, i.e. waiting for buffer space, messages or door bells
+   uint64_t waitSpins = 0;
+   /// Work requests, whose payload was inlined into the work queue entry
+   uint64_t inlinedWrs = 0;
+   /// Completion queue polls, that returned no completion
+   uint64_t emptyCqPolls = 0;
+   /// Work completions, that were polled
+   uint64_t completions = 0;
+   /// Bytes in the ring buffer, that the receiver did not consume yet, as last seen by the sender (a gauge)
+   uint64_t ringOccupancy = 0;
+   /// Messages, that an unreliable connection lost on the way
+   uint64_t droppedMessages = 0;
+
+   TransportStats &operator+=(const TransportStats &other) {
+      messagesSent += other.messagesSent;
+      bytesSent += other.bytesSent;
+      messagesReceived += other.messagesReceived;
+      bytesReceived += other.bytesReceived;
+      sendStalls += other.sendStalls;
+      waitSpins += other.waitSpins;
+      inlinedWrs += other.inlinedWrs;
+      emptyCqPolls += other.emptyCqPolls;
+      completions += other.completions;
+      ringOccupancy += other.ringOccupancy;
+      droppedMessages += other.droppedMessages;
+      return *this;
+   }
+
+   /// Column names matching operator<<
+   static const char *header() {
+      return "messages sent, bytes sent, messages received, bytes received, send stalls, wait spins, inlined wrs, "
+             "empty cq polls, completions, ring occupancy, dropped messages";
+   }
+
+   friend std::ostream &operator<<(std::ostream &out, const TransportStats &stats) {
+      return out << stats.messagesSent << ", " << stats.bytesSent << ", " << stats.messagesReceived << ", "
+                 << stats.bytesReceived << ", " << stats.sendStalls << ", " << stats.waitSpins << ", "
+                 << stats.inlinedWrs << ", " << stats.emptyCqPolls << ", " << stats.completions << ", "
+                 << stats.ringOccupancy << ", " << stats.droppedMessages;
+   }
+};
+
+/// The counters of a CounterBlock, in the order of the TransportStats fields
+enum class Stat : uint8_t {
+   MessagesSent,
+   BytesSent,
+   MessagesReceived,
+   BytesReceived,
+   SendStalls,
+   WaitSpins,
+   InlinedWrs,
+   EmptyCqPolls,
+   Completions,
+   RingOccupancy,
+   DroppedMessages,
+};
+
+/// The counters of one connection, on their own cache lines, so connections of different threads don't false share
+struct alignas(64) CounterBlock {
+   static constexpr size_t statCount = 11;
+   std::array<std::atomic<uint64_t>, statCount> values{};
+
+   uint64_t get(Stat stat) const { return values[static_cast<size_t>(stat)].load(std::memory_order_relaxed); }
+
+   TransportStats snapshot() const {
+      return TransportStats{get(Stat::MessagesSent), get(Stat::BytesSent), get(Stat::MessagesReceived),
+                            get(Stat::BytesReceived), get(Stat::SendStalls), get(Stat::WaitSpins),
+                            get(Stat::InlinedWrs), get(Stat::EmptyCqPolls), get(Stat::Completions),
+                            get(Stat::RingOccupancy), get(Stat::DroppedMessages)};
+   }
+};
+
+/// Storage for the counters of a new connection: a slot of this process' stats segment, if it publishes its
+/// statistics (see util/StatsSegment.h), otherwise a private block
+CounterBlock *acquireCounters(std::string_view name);
+
+void releaseCounters(CounterBlock *block);
+
+/**
+ * The live counters of one connection. Only the thread driving the connection counts (relaxed load + store, no
+ * locked instruction), snapshot() may be called concurrently from any thread, or even from another process through
+ * the stats segment.
+ * Counting is only compiled in with L5RDMA_STATS (cmake -DL5RDMA_STATS=ON). Otherwise no counters are allocated,
+ * add() is a no-op, and all stats read as 0.
+ */
+class StatCounters {
+   CounterBlock *block = nullptr;
+
+   public:
+   /// Marker, that CompletionQueuePair::poll*CompletionQueue returns when there is no completion
+   static constexpr uint64_t noCompletion = std::numeric_limits<uint64_t>::max();
+
+   /// name describes the connection in the stats segment, e.g. "rdma", or "multiclient rdma server"
+   explicit StatCounters(std::string_view name = "connection") {
+      if constexpr (statsEnabled) {
+         block = acquireCounters(name);
+      }
+   }
+
+   ~StatCounters() {
+      if (block != nullptr) {
+         releaseCounters(block);
+      }
+   }
+
+   StatCounters(StatCounters &&other) noexcept : block(std::exchange(other.block, nullptr)) {}
+
+   StatCounters &operator=(StatCounters &&other) noexcept {
+      std::swap(block, other.block);
+      return *this;
+   }
+
+   void add(Stat stat, uint64_t value = 1) {
+      if constexpr (statsEnabled) {
+         auto &counter = block->values[static_cast<size_t>(stat)];
+         counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+      }
+   }
+
+   /// Update a gauge, like the ring occupancy
+   void set(Stat stat, uint64_t value) {
+      if constexpr (statsEnabled) {
+         block->values[static_cast<size_t>(stat)].store(value, std::memory_order_relaxed);
+      }
+   }
+
+   void sent(size_t bytes) {
+      add(Stat::MessagesSent);
+      add(Stat::BytesSent, bytes);
+   }
+
+   void received(size_t bytes) {
+      add(Stat::MessagesReceived);
+      add(Stat::BytesReceived, bytes);
+   }
+
+   /// Pass through the result of a non-blocking completion queue poll, counting it as empty or as completion
+   uint64_t poll(uint64_t completionId) {
+      add(completionId == noCompletion ? Stat::EmptyCqPolls : Stat::Completions);
+      return completionId;
+   }
+
+   TransportStats snapshot() const {
+      if constexpr (statsEnabled) {
+         return block != nullptr ? block->snapshot() : TransportStats{};
+      } else {
+         return {};
+      }
+   }
+};
+} // namespace util
+} // namespace l5
+
+#endif //L5RDMA_TRANSPORTSTATS_H
@@ -0,0 +1,146 @@
+#ifndef L5RDMA_ZIPF_H
+#define L5RDMA_ZIPF_H
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+/**
+ * Zipf distributed ranks in [0, itemCount), rank 0 being the most frequent one.
+ * Uses rejection-inversion sampling (Hörmann and Derflinger, "Rejection-inversion to generate variates from monotone
+ * discrete distributions", 1996): O(1) time per sample, no per item tables, and any exponent > 0, including 1.0.
+ */
+class ZipfGenerator {
+   std::mt19937_64 generator;
+   std::uniform_real_distribution<double> uniform{0.0, 1.0};
+   double exponent;
+   uint64_t itemCount = 0;
+   double hIntegralX1;
+   double hIntegralN = 0;
+   double s;
+
+   /// log1p(x) / x, stable for x close to 0
+   static double helper1(double x) {
+      if (std::abs(x) > 1e-8) {
+         return std::log1p(x) / x;
+      }
+      return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+   }
+
+   /// expm1(x) / x, stable for x close to 0
+   static double helper2(double x) {
+      if (std::abs(x) > 1e-8) {
+         return std::expm1(x) / x;
+      }
+      return 1.0 + x * 0.5 * (1.0 + x * 1.0 / 3.0 * (1.0 + 0.25 * x));
+   }
+
+   /// x^-exponent
+   double h(double x) const {
+      return std::exp(-exponent * std::log(x));
+   }
+
+   /// Integral of h, shifted so it is well defined for exponent 1.0
+   double hIntegral(double x) const {
+      const auto logX = std::log(x);
+      return helper2((1.0 - exponent) * logX) * logX;
+   }
+
+   double hIntegralInverse(double x) const {
+      auto t = x * (1.0 - exponent);
+      if (t < -1.0) {
+         t = -1.0; // numerical inaccuracies for x close to the minimum
+      }
+      return std::exp(helper1(t) * x);
+   }
+
+   public:
+   /**
+    * @param itemCount number of distinct ranks
+    * @param exponent skew, YCSB uses 0.99
+    */
+   explicit ZipfGenerator(uint64_t itemCount, double exponent = 0.99, uint64_t seed = 88172645463325252ull) :
+         generator(seed),
+         exponent(exponent),
+         hIntegralX1(hIntegral(1.5) - 1.0),
+         s(2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0))) {
+      setItemCount(itemCount);
+   }
+
+   /// Change the number of ranks, e.g. after inserts. O(1)
+   void setItemCount(uint64_t count) {
+      itemCount = count;
+      hIntegralN = hIntegral(static_cast<double>(count) + 0.5);
+   }
+
+   uint64_t getItemCount() const { return itemCount; }
+
+   uint64_t next() {
+      for (;;) {
+         const auto u = hIntegralN + uniform(generator) * (hIntegralX1 - hIntegralN);
+         const auto x = hIntegralInverse(u);
+         auto k = static_cast<uint64_t>(x + 0.5);
+         if (k < 1) {
+            k = 1;
+         } else if (k > itemCount) {
+            k = itemCount;
+         }
+         const auto kd = static_cast<double>(k);
+         if (kd - x <= s || u >= hIntegral(kd + 0.5) - h(kd)) {
+            return k - 1;
+         }
+      }
+   }
+};
+
+/// 64 bit FNV-1a over the bytes of value
+inline uint64_t fnvHash64(uint64_t value) {
+   uint64_t hash = 0xcbf29ce484222325ull;
+   for (int i = 0; i < 8; ++i) {
+      hash ^= value & 0xff;
+      hash *= 0x100000001b3ull;
+      value >>= 8;
+   }
+   return hash;
+}
+
+/**
+ * YCSB's scrambled Zipfian: Zipf distributed popularity, but the popular keys are spread over the whole key space,
+ * instead of being clustered at the start
+ */
+class ScrambledZipfGenerator {
+   ZipfGenerator zipf;
+
+   public:
+   explicit ScrambledZipfGenerator(uint64_t itemCount, double exponent = 0.99,
+                                   uint64_t seed = 88172645463325252ull) : zipf(itemCount, exponent, seed) {}
+
+   uint64_t next() {
+      return fnvHash64(zipf.next()) % zipf.getItemCount();
+   }
+};
+
+/**
+ * YCSB's latest distribution: the most recently inserted keys are the most popular ones.
+ * Call setLatest() after inserts, so the hot spot moves along with them.
+ */
+class LatestGenerator {
+   ZipfGenerator zipf;
+   uint64_t latest;
+
+   public:
+   /// @param latest the most recently inserted key, keys are assumed to be in [0, latest]
+   explicit LatestGenerator(uint64_t latest, double exponent = 0.99, uint64_t seed = 88172645463325252ull) :
+         zipf(latest + 1, exponent, seed), latest(latest) {}
+
+   void setLatest(uint64_t key) {
+      latest = key;
+      zipf.setItemCount(key + 1);
+   }
+
+   uint64_t next() {
+      return latest - zipf.next();
+   }
+};
+
+#endif //L5RDMA_ZIPF_H
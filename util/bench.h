@@ -6,6 +6,11 @@
 #include <vector>
 #include <iterator>
 #include <chrono>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "util/Histogram.h"
+#include "util/PerfCounters.h"
 
 double getGlobalStat() {
    auto globalStat = std::ifstream("/proc/stat", std::ios::in);
@@ -37,16 +42,26 @@ std::tuple<double, double> getOwnStat() {
    return {utime, stime};
 }
 
+/**
+ * Run fun repetitions times and print the average time and CPU usage.
+ * With L5RDMA_PERF set, also collects hardware counters (see PerfEvents), normalized per unit of workSize. print may
+ * take them as an additional const PerfCounters & argument, the default printer appends them as CSV columns.
+ */
 template<typename Benchmark, typename Printer>
 auto bench(size_t workSize, Benchmark &&fun, Printer &&print =
-[](auto workSize_, auto avgTime, auto userPercent, auto systemPercent, auto totalPercent) {
+[](auto workSize_, auto avgTime, auto userPercent, auto systemPercent, auto totalPercent,
+   const PerfCounters &perf) {
    std::cout << workSize_ << ", "
              << avgTime << ", "
              << (workSize_ / avgTime) << ", "
              << userPercent << ", "
              << systemPercent << ", "
-             << totalPercent << '\n';
+             << totalPercent;
+   printPerfColumns(std::cout, perf);
+   std::cout << '\n';
 }, size_t repetitions = 1) {
+   const auto perfEnabled = PerfEvents::enabled();
+   auto perfEvents = std::unique_ptr<PerfEvents>(perfEnabled ? new PerfEvents() : nullptr);
    std::vector<std::tuple<double, double, double>> cpuLoads;
    std::vector<double> times;
 
@@ -55,11 +70,13 @@ auto bench(size_t workSize, Benchmark &&fun, Printer &&print =
       const auto
       [ownUserBefore, ownSystemBefore] = getOwnStat();
 
+      if (perfEvents) perfEvents->start();
       const auto start = std::chrono::steady_clock::now();
 
       fun();
 
       const auto end = std::chrono::steady_clock::now();
+      if (perfEvents) perfEvents->stop();
 
       const auto after = getGlobalStat();
       const auto
@@ -95,20 +112,65 @@ auto bench(size_t workSize, Benchmark &&fun, Printer &&print =
       return total / repetitions;
    }();
 
-   print(workSize, avgTime, userPercent, systemPercent, totalPercent);
+   // printers may optionally take the hardware counters, normalized per unit of work
+   const auto perf = perfEvents ? perfEvents->normalized(static_cast<double>(workSize * repetitions)) : PerfCounters{};
+   if constexpr (std::is_invocable_v<Printer, size_t, double, double, double, double, const PerfCounters &>) {
+      print(workSize, avgTime, userPercent, systemPercent, totalPercent, perf);
+   } else {
+      print(workSize, avgTime, userPercent, systemPercent, totalPercent);
+   }
 }
 
 template<typename Benchmark>
 auto bench(size_t workSize, Benchmark &&fun, size_t repetitions = 1) {
    bench(workSize, std::forward<Benchmark>(fun),
-         [](auto workSize_, auto avgTime, auto userPercent, auto systemPercent, auto totalPercent) {
+         [](auto workSize_, auto avgTime, auto userPercent, auto systemPercent, auto totalPercent,
+            const PerfCounters &perf) {
             std::cout << workSize_ << ", "
                       << avgTime << ", "
                       << (workSize_ / avgTime) << ", "
                       << userPercent << ", "
                       << systemPercent << ", "
-                      << totalPercent << '\n';
+                      << totalPercent;
+            printPerfColumns(std::cout, perf);
+            std::cout << '\n';
          }, repetitions);
 }
 
+/**
+ * Like bench, but fun records per message latencies (in ns) to the Histogram it gets passed. Multithreaded benchmarks
+ * should record to one histogram per thread and merge them into it at the end.
+ * Prints the usual columns, followed by p50, p99, p99.9 and max latency in us (see Histogram::summaryHeader) and the
+ * hardware counters, if enabled (see perfHeader). If fun returns a value, it is printed as an additional column before
+ * the latencies.
+ */
+template<typename Benchmark>
+auto benchLatency(size_t workSize, Benchmark &&fun) {
+   using Extra = decltype(fun(std::declval<Histogram &>()));
+   auto latencies = Histogram();
+   auto extra = std::conditional_t<std::is_void_v<Extra>, int, Extra>();
+   bench(workSize, [&] {
+            if constexpr (std::is_void_v<Extra>) {
+               fun(latencies);
+            } else {
+               extra = fun(latencies);
+            }
+         },
+         [&](auto workSize_, auto avgTime, auto userPercent, auto systemPercent, auto totalPercent,
+             const PerfCounters &perf) {
+            std::cout << workSize_ << ", "
+                      << avgTime << ", "
+                      << (workSize_ / avgTime) << ", "
+                      << userPercent << ", "
+                      << systemPercent << ", "
+                      << totalPercent << ", ";
+            if constexpr (not std::is_void_v<Extra>) {
+               std::cout << extra << ", ";
+            }
+            latencies.printSummary(std::cout, 1e3);
+            printPerfColumns(std::cout, perf);
+            std::cout << '\n';
+         });
+}
+
 #endif //L5RDMA_BENCH_H
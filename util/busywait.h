@@ -1,6 +1,7 @@
 #ifndef L5RDMA_BUSYWAIT_H
 #define L5RDMA_BUSYWAIT_H
 
+#include <sched.h>
 #include <unistd.h>
 #include <xmmintrin.h>
 
@@ -27,8 +28,9 @@ namespace {
     }
 
     //static std::vector<int> samples = {};
+    /// Returns how often cond() still held after fun(), i.e. the number of iterations without progress
     template<typename Fun, typename Cond>
-    void niceWait(Fun &&fun, Cond &&cond) {
+    int niceWait(Fun &&fun, Cond &&cond) {
         int tries = 0;
         do {
             yield(tries);
@@ -36,6 +38,7 @@ namespace {
             ++tries;
         } while (cond());
         //samples.push_back(tries);
+        return tries - 1;
     }
 
     //void printSamples() {
@@ -49,7 +52,7 @@ namespace {
 }
 
 template<typename... Args>
-constexpr void loop_while(Args &&... args) {
+constexpr int loop_while(Args &&... args) {
     return niceWait(std::forward<Args>(args)...);
 }
 
@@ -2,8 +2,10 @@
 #define L5RDMA_VIRTUALMEMORY_H
 
 #include <memory>
+#include <string>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <cstring>
 #include <sys/file.h>
 
@@ -68,16 +70,18 @@ public:
  * For reliability, the server should not mmap(2) client's objects for read-access as the client might truncate the file
  * simultaneously, causing SIGBUS on the server. A server can protect itself via SIGBUS-handlers, but sealing is a much
  * simpler way. By requiring F_SEAL_SHRINK, the server can be sure, the file will never shrink.
+ * Usually, the name is removed right away and the mapping is only shared by passing its fd. With keepName, the segment
+ * stays visible in /dev/shm until the mapping is released, so other processes can attach_shared() to it by name.
  */
 template<typename T>
-ShmMapping<T> malloc_shared(const std::string &name, size_t size, void *addr = nullptr) {
+ShmMapping<T> malloc_shared(const std::string &name, size_t size, void *addr = nullptr, bool keepName = false) {
     // create a new mapping in /dev/shm
     const auto fd = shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_EXCL, 0666);
     if (fd < 0) {
         perror("shm_open");
         throw std::runtime_error{"shm_open failed"};
     }
-    if (shm_unlink(name.c_str()) < 0) {
+    if (not keepName && shm_unlink(name.c_str()) < 0) {
         perror("shm_unlink");
         throw std::runtime_error{"shm_unlink failed"};
     }
@@ -86,8 +90,11 @@ ShmMapping<T> malloc_shared(const std::string &name, size_t size, void *addr = n
         throw std::runtime_error{"ftruncate failed"};
     }
 
-    auto deleter = [size](void *p) {
+    auto deleter = [size, name = keepName ? name : std::string()](void *p) {
         munmap(p, size);
+        if (not name.empty()) {
+            shm_unlink(name.c_str());
+        }
     };
     auto ptr = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
 
@@ -106,6 +113,32 @@ ShmMapping<T> malloc_shared(int fd, size_t size, void *addr = nullptr) {
    return ShmMapping<T>( fd, std::shared_ptr<T>(reinterpret_cast<T *>(ptr), deleter) );
 }
 
+/// Map an existing named segment (see malloc_shared with keepName) read-only, e.g. to inspect it from another process
+template<typename T>
+ShmMapping<const T> attach_shared(const std::string &name) {
+   const auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+   if (fd < 0) {
+      throw std::runtime_error{"shm_open failed: " + name};
+   }
+   struct stat info{};
+   if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      ::close(fd);
+      throw std::runtime_error{"could not determine the size of " + name};
+   }
+
+   const auto size = static_cast<size_t>(info.st_size);
+   auto deleter = [size](const void *p) {
+      munmap(const_cast<void *>(p), size);
+   };
+   auto ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+   if (ptr == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error{"mmap failed: " + name};
+   }
+
+   return ShmMapping<const T>(fd, std::shared_ptr<const T>(reinterpret_cast<const T *>(ptr), deleter));
+}
+
 WraparoundBuffer mmapRingBuffer(int fd, size_t size, bool init = false);
 
 WraparoundBuffer mmapSharedRingBuffer(const std::string &name, size_t size, bool init = false);
@@ -3,10 +3,21 @@
 
 #include <algorithm>
 #include <array>
-#include <random>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 #include <string_view>
-#include <unordered_map>
+#include <sys/mman.h>
+#include <tbb/parallel_for.h>
+#include <unistd.h>
+#include <vector>
 #include "util/Random32.h"
+#include "util/Zipf.h"
 #include "util/doNotOptimize.h"
 
 /// YCSB Benchmark workload, based on Alexander van Renen's version
@@ -84,58 +95,412 @@ auto generateLookupKeys(size_t count, size_t maxValue) {
    return res;
 }
 
-auto generateZipfLookupKeys(size_t count, double factor = 1.0) {
-   using distribution = std::discrete_distribution<size_t>;
-   std::mt19937 generator(88172645463325252ull);
-   auto zipfdist = [&] {
-      std::vector<double> buffer(ycsb_tuple_count + 1);
-      for (unsigned rank = 1; rank <= ycsb_tuple_count; ++rank) {
-         buffer[rank] = std::pow(rank, -factor);
-      }
-
-      return distribution(buffer.begin() + 1, buffer.end());
-   }();
-   auto rand = [&] { return zipfdist(generator); };
-
+/// Zipf distributed keys, the lowest keys being the most frequent ones. Cheap enough to call per client thread
+inline auto generateZipfLookupKeys(size_t count, double factor = 1.0) {
+   auto zipf = ZipfGenerator(ycsb_tuple_count, factor);
    auto res = std::vector<YcsbKey>();
    res.reserve(count);
-   std::generate_n(std::back_inserter(res), count, [&] { return rand(); });
+   std::generate_n(std::back_inserter(res), count, [&] { return static_cast<YcsbKey>(zipf.next()); });
    return res;
 }
 
-struct YcsbDatabase {
-   std::unordered_map<YcsbKey, YcsbDataSet> database{};
+/**
+ * Snapshot file format: a YcsbSnapshotHeader, then the raw tuples at ycsbSnapshotDataOffset, which is page aligned, so
+ * the tuples can be mapped directly
+ */
+struct YcsbSnapshotHeader {
+   char magic[8];
+   uint64_t tupleCount;
+   uint64_t tupleSize;
+};
+static constexpr char ycsbSnapshotMagic[8] = {'L', '5', 'Y', 'C', 'S', 'B', '0', '1'};
+static constexpr off_t ycsbSnapshotDataOffset = 4096;
+static constexpr auto ycsbSnapshotPath = "/tmp/l5rdma-ycsb.snapshot";
+
+/**
+ * Flat storage for the YCSB tuples. Keys are dense, so the tuple of a key lives at tuples[key], which makes every lookup
+ * a single address computation instead of chasing hash map nodes.
+ * The tuples are stored in one anonymous mapping, backed by huge pages if possible, so the whole table can also be
+ * registered for RDMA as a single memory region (see data() and sizeInBytes()). Copies share the same storage.
+ * Generating the tuples takes a while, so benchmarks should use openSnapshot, which maps a binary snapshot file instead.
+ * lookup, update, readModifyWrite, insert and scan are thread safe. Writers lock one of the striped mutexes, readers
+ * don't lock at all: they copy the tuple and retry, if the stripe's seqlock version changed in the meantime. Inserts
+ * append the next key, up to the capacity given at construction. The raw accessors (operator[], begin(), end()) aren't
+ * synchronized.
+ */
+class YcsbDatabase {
+   static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+   static constexpr size_t lockStripes = 1024;
+
+   struct alignas(64) Stripe {
+      std::mutex mutex;
+      /// Odd, while a writer modifies one of the stripe's tuples
+      std::atomic<uint64_t> version{0};
+   };
+
+   /// Excludes the other writers of a stripe and makes its concurrent readers retry
+   class WriteGuard {
+      Stripe &stripe;
+      std::lock_guard<std::mutex> lock;
+
+      public:
+      explicit WriteGuard(Stripe &stripe) : stripe(stripe), lock(stripe.mutex) {
+         stripe.version.store(stripe.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_release);
+      }
+
+      ~WriteGuard() {
+         stripe.version.store(stripe.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      }
+   };
+
+   /// Shared by all copies
+   struct State {
+      std::atomic<size_t> count;
+      std::mutex insertMutex;
+      std::array<Stripe, lockStripes> stripes;
+   };
 
-   YcsbDatabase() {
-      auto gen = RandomString();
-      database.reserve(ycsb_tuple_count);
+   size_t capacity;
+   size_t mappedSize;
+   std::shared_ptr<YcsbDataSet> tuples;
+   std::shared_ptr<State> state = std::make_shared<State>();
 
-      auto nextKey = uint32_t(0);
-      for (size_t i = 0; i < ycsb_tuple_count; ++i) {
-         database.emplace(nextKey++, YcsbDataSet(gen));
+   /// Try explicit huge pages first, fall back to transparent huge pages
+   static std::shared_ptr<YcsbDataSet> allocate(size_t mappedSize, bool hugePages) {
+      auto ptr = MAP_FAILED;
+      if (hugePages) {
+         ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      }
+      if (ptr == MAP_FAILED) {
+         ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (ptr == MAP_FAILED) {
+            perror("mmap");
+            throw std::runtime_error{"mmap failed"};
+         }
+         if (hugePages) {
+            madvise(ptr, mappedSize, MADV_HUGEPAGE);
+         }
+      }
+      return std::shared_ptr<YcsbDataSet>(reinterpret_cast<YcsbDataSet *>(ptr), [mappedSize](YcsbDataSet *p) {
+         munmap(p, mappedSize);
+      });
+   }
+
+   Stripe &stripeOf(YcsbKey key) const {
+      return state->stripes[key % lockStripes];
+   }
+
+   /// Seqlock read: repeat read, until no writer modified the key's stripe while it ran
+   template<typename Read>
+   auto readConsistent(YcsbKey key, Read &&read) const {
+      const auto &version = stripeOf(key).version;
+      for (;;) {
+         const auto before = version.load(std::memory_order_acquire);
+         if (before % 2 != 0) {
+            continue;
+         }
+         auto result = read();
+         std::atomic_thread_fence(std::memory_order_acquire);
+         if (version.load(std::memory_order_relaxed) == before) {
+            return result;
+         }
+      }
+   }
+
+   void checkKey(YcsbKey key) const {
+      if (key >= size()) {
+         throw std::out_of_range{"no such YCSB key"};
+      }
+   }
+
+   /// Only allocates the storage, without any tuples
+   YcsbDatabase(size_t capacity, bool hugePages) :
+         capacity(capacity),
+         mappedSize((capacity * sizeof(YcsbDataSet) + hugePageSize - 1) / hugePageSize * hugePageSize),
+         tuples(allocate(mappedSize, hugePages)) {
+      state->count = 0;
+   }
+
+   /// Generate count random tuples in parallel. Every block has its own seed, so the result is deterministic
+   void generate(size_t count) {
+      static constexpr size_t blockSize = 16 * 1024;
+      const auto blocks = (count + blockSize - 1) / blockSize;
+      tbb::parallel_for(size_t(0), blocks, [&](size_t block) {
+         auto gen = RandomString{Random32(static_cast<uint32_t>(block + 1))};
+         const auto end = std::min(count, (block + 1) * blockSize);
+         for (auto i = block * blockSize; i < end; ++i) {
+            new(&tuples.get()[i]) YcsbDataSet(gen);
+         }
+      });
+      state->count = count;
+   }
+
+   public:
+   /**
+    * @param hugePages try to back the tuples with huge pages
+    * @param count number of tuples to generate
+    * @param capacity maximum number of tuples including inserts, at least count
+    */
+   explicit YcsbDatabase(bool hugePages = true, size_t count = ycsb_tuple_count, size_t capacity = 0) :
+         YcsbDatabase(std::max(count, capacity), hugePages) {
+      generate(count);
+   }
+
+   /**
+    * Map a snapshot written by saveSnapshot. The file is mapped privately, so updates and inserts are never written
+    * back. Tuples are only paged in on first access, so this returns in milliseconds.
+    * @param capacity maximum number of tuples including inserts
+    */
+   static YcsbDatabase fromSnapshot(const std::string &path, size_t capacity = 0) {
+      const auto fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+         throw std::runtime_error{"could not open YCSB snapshot " + path};
+      }
+      auto header = YcsbSnapshotHeader{};
+      if (::pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+          std::memcmp(header.magic, ycsbSnapshotMagic, sizeof(header.magic)) != 0 ||
+          header.tupleSize != sizeof(YcsbDataSet)) {
+         ::close(fd);
+         throw std::runtime_error{"invalid YCSB snapshot " + path};
+      }
+
+      // reserve the whole capacity, then map the snapshot over its beginning
+      auto database = YcsbDatabase(std::max<size_t>(header.tupleCount, capacity), false);
+      const auto ptr = mmap(database.data(), header.tupleCount * sizeof(YcsbDataSet), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_FIXED, fd, ycsbSnapshotDataOffset);
+      ::close(fd);
+      if (ptr == MAP_FAILED) {
+         perror("mmap");
+         throw std::runtime_error{"mmap failed"};
+      }
+      database.state->count = header.tupleCount;
+      return database;
+   }
+
+   /// Map the snapshot at path, if there is a valid one with count tuples, otherwise generate the tuples and save them
+   static YcsbDatabase openSnapshot(const std::string &path = ycsbSnapshotPath, size_t count = ycsb_tuple_count,
+                                    size_t capacity = 0) {
+      try {
+         auto database = fromSnapshot(path, capacity);
+         if (database.size() == count) {
+            return database;
+         }
+      } catch (const std::runtime_error &) {
+         // no usable snapshot yet
+      }
+      auto database = YcsbDatabase(true, count, capacity);
+      database.saveSnapshot(path);
+      return database;
+   }
+
+   /// Write all tuples to path, replacing it atomically
+   void saveSnapshot(const std::string &path) const {
+      const auto tmpPath = path + ".tmp";
+      const auto fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) {
+         perror("open");
+         throw std::runtime_error{"could not create YCSB snapshot " + tmpPath};
+      }
+      auto header = YcsbSnapshotHeader{};
+      std::memcpy(header.magic, ycsbSnapshotMagic, sizeof(header.magic));
+      header.tupleCount = size();
+      header.tupleSize = sizeof(YcsbDataSet);
+
+      const auto writeAll = [&](const void *buffer, size_t length, off_t offset) {
+         auto begin = reinterpret_cast<const uint8_t *>(buffer);
+         while (length > 0) {
+            const auto written = ::pwrite(fd, begin, length, offset);
+            if (written < 0) {
+               perror("pwrite");
+               ::close(fd);
+               throw std::runtime_error{"could not write YCSB snapshot"};
+            }
+            begin += written;
+            length -= static_cast<size_t>(written);
+            offset += written;
+         }
+      };
+      writeAll(&header, sizeof(header), 0);
+      writeAll(tuples.get(), size() * sizeof(YcsbDataSet), ycsbSnapshotDataOffset);
+      ::close(fd);
+      if (::rename(tmpPath.c_str(), path.c_str()) != 0) {
+         perror("rename");
+         throw std::runtime_error{"could not rename YCSB snapshot"};
       }
    }
 
    template<typename OutputIterator>
    void lookup(YcsbKey lookupKey, size_t field, OutputIterator target) const {
-      const auto fieldPtr = database.find(lookupKey);
-      if (fieldPtr == database.end()) {
-         throw;
-      }
-      const auto begin = fieldPtr->second[field].begin();
-      const auto end = fieldPtr->second[field].end();
-      std::copy(begin, end, target);
+      checkKey(lookupKey);
+      const auto value = readConsistent(lookupKey, [&] { return tuples.get()[lookupKey][field]; });
+      std::copy(value.begin(), value.end(), target);
    }
 
    template<typename OutputIterator>
    void lookup(YcsbKey lookupKey, OutputIterator target) const {
-      const auto fieldPtr = database.find(lookupKey);
-      if (fieldPtr == database.end()) {
-         throw;
+      checkKey(lookupKey);
+      const auto tuple = readConsistent(lookupKey, [&] { return tuples.get()[lookupKey]; });
+      std::copy(tuple.begin(), tuple.end(), target);
+   }
+
+   /// Overwrite field of key with ycsb_field_length chars from value
+   void update(YcsbKey key, size_t field, const char *value) {
+      checkKey(key);
+      const auto guard = WriteGuard(stripeOf(key));
+      std::copy(value, value + ycsb_field_length, tuples.get()[key][field].begin());
+   }
+
+   /// Atomically read the old value of field to target, then update it
+   template<typename OutputIterator>
+   void readModifyWrite(YcsbKey key, size_t field, const char *value, OutputIterator target) {
+      checkKey(key);
+      const auto guard = WriteGuard(stripeOf(key));
+      auto &row = tuples.get()[key][field];
+      std::copy(row.begin(), row.end(), target);
+      std::copy(value, value + ycsb_field_length, row.begin());
+   }
+
+   /// Append tuple with the next free key. Returns the new key
+   YcsbKey insert(const YcsbDataSet &tuple) {
+      const auto insertLock = std::lock_guard(state->insertMutex);
+      const auto key = state->count.load(std::memory_order_relaxed);
+      if (key >= capacity) {
+         throw std::length_error{"YcsbDatabase is full"};
+      }
+      {
+         const auto guard = WriteGuard(stripeOf(static_cast<YcsbKey>(key)));
+         new(&tuples.get()[key]) YcsbDataSet(tuple);
+      }
+      state->count.store(key + 1, std::memory_order_release);
+      return static_cast<YcsbKey>(key);
+   }
+
+   /// Copy up to length tuples, starting at startKey, to target. Returns the number of copied tuples
+   template<typename OutputIterator>
+   size_t scan(YcsbKey startKey, size_t length, OutputIterator target) const {
+      checkKey(startKey);
+      const auto end = std::min(size(), startKey + length);
+      for (auto key = startKey; key < end; ++key) {
+         const auto tuple = readConsistent(key, [&] { return tuples.get()[key]; });
+         target = std::copy(tuple.begin(), tuple.end(), target);
+      }
+      return end - startKey;
+   }
+
+   const YcsbDataSet &at(YcsbKey key) const {
+      checkKey(key);
+      return tuples.get()[key];
+   }
+
+   YcsbDataSet &operator[](YcsbKey key) { return tuples.get()[key]; }
+
+   const YcsbDataSet &operator[](YcsbKey key) const { return tuples.get()[key]; }
+
+   /// Tuples in key order
+   YcsbDataSet *begin() { return tuples.get(); }
+
+   YcsbDataSet *end() { return tuples.get() + size(); }
+
+   const YcsbDataSet *begin() const { return tuples.get(); }
+
+   const YcsbDataSet *end() const { return tuples.get() + size(); }
+
+   YcsbDataSet *data() { return tuples.get(); }
+
+   size_t size() const { return state->count.load(std::memory_order_acquire); }
+
+   /// Size of the underlying mapping, e.g. to register it as memory region
+   size_t sizeInBytes() const { return mappedSize; }
+};
+
+enum class YcsbOperation : uint8_t {
+   Read,
+   Update,
+   Insert,
+   Scan,
+   ReadModifyWrite,
+};
+
+/// Operation mix of a YCSB workload. The proportions should sum up to 1
+struct YcsbWorkload {
+   double read;
+   double update;
+   double insert;
+   double scan;
+   double readModifyWrite;
+   /// Request the most recently inserted keys most often (workload D), instead of the zipfian lowest keys
+   bool latest;
+   /// Scan lengths are uniformly distributed in [1, maxScanLength]
+   uint32_t maxScanLength;
+};
+
+/// The core YCSB workloads A - F
+inline YcsbWorkload ycsbWorkload(char name) {
+   switch (name) {
+      case 'A': // update heavy
+         return {0.5, 0.5, 0, 0, 0, false, 100};
+      case 'B': // read mostly
+         return {0.95, 0.05, 0, 0, 0, false, 100};
+      case 'C': // read only
+         return {1.0, 0, 0, 0, 0, false, 100};
+      case 'D': // read latest
+         return {0.95, 0, 0.05, 0, 0, true, 100};
+      case 'E': // short ranges
+         return {0, 0, 0.05, 0.95, 0, false, 100};
+      case 'F': // read-modify-write
+         return {0.5, 0, 0, 0, 0.5, false, 100};
+      default:
+         throw std::invalid_argument{"unknown YCSB workload"};
+   }
+}
+
+struct YcsbRequest {
+   YcsbOperation operation;
+   uint32_t field;
+   YcsbKey key;
+   uint32_t scanLength;
+};
+
+/// Client side generator for the requests of a workload
+class YcsbRequestGenerator {
+   YcsbWorkload workload;
+   Random32 rand;
+   ZipfGenerator zipf;
+   LatestGenerator latest;
+
+   /// [0, 1)
+   double uniform() {
+      return rand.next() / 4294967296.0;
+   }
+
+   public:
+   YcsbRequestGenerator(const YcsbWorkload &workload, size_t recordCount, uint32_t seed = 314159265) :
+         workload(workload), rand(seed), zipf(recordCount, 0.99, seed), latest(recordCount - 1, 0.99, seed) {}
+
+   YcsbRequest next() {
+      auto request = YcsbRequest{};
+      auto choice = uniform();
+      if ((choice -= workload.read) < 0) {
+         request.operation = YcsbOperation::Read;
+      } else if ((choice -= workload.update) < 0) {
+         request.operation = YcsbOperation::Update;
+      } else if ((choice -= workload.insert) < 0) {
+         request.operation = YcsbOperation::Insert;
+      } else if ((choice -= workload.scan) < 0) {
+         request.operation = YcsbOperation::Scan;
+         request.scanLength = 1 + rand.next() % workload.maxScanLength;
+      } else {
+         request.operation = YcsbOperation::ReadModifyWrite;
       }
-      const auto begin = fieldPtr->second.begin();
-      const auto end = fieldPtr->second.end();
-      std::copy(begin, end, target);
+      request.field = rand.next() % ycsb_field_count;
+      request.key = static_cast<YcsbKey>(workload.latest ? latest.next() : zipf.next());
+      return request;
+   }
+
+   /// Report the key of a completed insert, so the latest distribution follows the inserts
+   void inserted(YcsbKey key) {
+      latest.setLatest(key);
    }
 };
 
@@ -28,16 +28,16 @@ static constexpr auto printResults = []
 };
 
 void doRunNoCommunication() {
-   const auto database = YcsbDatabase();
+   const auto database = YcsbDatabase::openSnapshot();
    YcsbDataSet data{};
 
    // measure bytes / seconds
    std::cout << "none, ";
-   bench(database.database.size() * 10 * sizeof(data), [&] {
+   bench(database.size() * 10 * sizeof(data), [&] {
       for (int i = 0; i < 10; ++i)
-         for (auto &lookup : database.database) {
+         for (auto &tuple : database) {
             DoNotOptimize(data);
-            std::copy(lookup.second.begin(), lookup.second.end(), data.begin());
+            std::copy(tuple.begin(), tuple.end(), data.begin());
             ClobberMemory();
          }
    }, printResults);
@@ -83,16 +83,16 @@ void doRun(bool isClient, std::string connection) {
       }
    } else { // server
       auto server = Server(connection);
-      const auto database = YcsbDatabase();
+      const auto database = YcsbDatabase::openSnapshot();
       server.accept();
       // measure bytes / s
       bench(ycsb_tuple_count * sizeof(YcsbDataSet), [&] {
          auto responses = ReadResponse{};
-         for (auto lookupIt = database.database.begin(); lookupIt != database.database.end();) {
+         for (auto lookupIt = database.begin(); lookupIt != database.end();) {
             for (auto &response : responses.data) {
-               std::copy(lookupIt->second.begin(), lookupIt->second.end(), response.begin());
+               std::copy(lookupIt->begin(), lookupIt->end(), response.begin());
                ++lookupIt;
-               if (lookupIt == database.database.end()) {
+               if (lookupIt == database.end()) {
                   break;
                }
             }
@@ -1,6 +1,8 @@
 #include "include/RdmaTransport.h"
+#include "util/Affinity.h"
 #include "util/bench.h"
 #include "util/ycsb.h"
+#include <optional>
 #include <thread>
 #include <include/DomainSocketsTransport.h>
 #include <include/MulticlientRDMATransport.h>
@@ -9,6 +11,8 @@
 #include <include/TcpTransport.h>
 
 using namespace l5::transport;
+using l5::util::Spread;
+using l5::util::Topology;
 
 constexpr size_t operator"" _k(unsigned long long i) { return i * 1024; }
 
@@ -29,7 +33,8 @@ static auto printResults = [](double workSize, auto avgTime,
 static auto database = std::optional<YcsbDatabase>();
 
 template <class Server, class Client>
-void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServer, size_t numServerThreads) {
+void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServer, size_t numServerThreads,
+           const Topology& topology, Spread spread) {
    struct ReadMessage {
       char next = '\0';
    };
@@ -43,7 +48,9 @@ void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServ
       std::vector<std::thread> clientThreads;
       for (size_t s = 0; s < numServerThreads; ++s)
          for (size_t c = 0; c < numClientThreadsPerServer; ++c)
-            clientThreads.emplace_back([&, s] {
+            clientThreads.emplace_back([&, s, c] {
+               // pin before connecting, so the connection gets the NIC and memory of this thread's node
+               topology.pin(s * numClientThreadsPerServer + c, spread);
                auto client = Client();
                for (int i = 0;; ++i) {
                   try {
@@ -92,6 +99,7 @@ void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServ
    } else { // server
       std::vector<std::thread> serverThreads;
       for (size_t s = 0; s < numServerThreads; ++s) serverThreads.emplace_back([&, s] {
+         topology.pin(s, spread);
          auto server = Server(connection + std::to_string(s));
          for (size_t i = 0; i < numClientThreadsPerServer; ++i) {
             server.accept();
@@ -102,12 +110,12 @@ void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServ
             char request;
             auto client = server.read(request);
             auto responses = ReadResponse{};
-            for (auto lookupIt = database->database.begin();
-                 lookupIt != database->database.end();) {
+            for (auto lookupIt = database->begin();
+                 lookupIt != database->end();) {
                for (auto& response : responses.data) {
-                  std::copy(lookupIt->second.begin(), lookupIt->second.end(), response.begin());
+                  std::copy(lookupIt->begin(), lookupIt->end(), response.begin());
                   ++lookupIt;
-                  if (lookupIt == database->database.end()) {
+                  if (lookupIt == database->end()) {
                      break;
                   }
                }
@@ -122,12 +130,12 @@ void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServ
                char request;
                auto client = server.read(request);
                auto responses = ReadResponse{};
-               for (auto lookupIt = database->database.begin();
-                    lookupIt != database->database.end();) {
+               for (auto lookupIt = database->begin();
+                    lookupIt != database->end();) {
                   for (auto& response : responses.data) {
-                     std::copy(lookupIt->second.begin(), lookupIt->second.end(), response.begin());
+                     std::copy(lookupIt->begin(), lookupIt->end(), response.begin());
                      ++lookupIt;
-                     if (lookupIt == database->database.end()) {
+                     if (lookupIt == database->end()) {
                         break;
                      }
                   }
@@ -145,7 +153,8 @@ void doRun(bool isClient, std::string connection, size_t numClientThreadsPerServ
 int main(int argc, char** argv) {
    if (argc < 2) {
       std::cout << "Usage: " << argv[0]
-                << " <client / server> <#clientThreadsPerServer = 1> <#serverTheads = 1> <IP = 127.0.0.1>" << std::endl;
+                << " <client / server> <#clientThreadsPerServer = 1> <#serverTheads = 1> <IP = 127.0.0.1>"
+                << " <thread placement: none / cores / nodes = none>" << std::endl;
       return -1;
    }
    const auto isClient = argv[1][0] == 'c';
@@ -153,7 +162,10 @@ int main(int argc, char** argv) {
    const auto numServerThreads = argc < 4 ? 1 : std::atoi(argv[3]);
 
    static constexpr uint16_t port = 123;
-   static const char* ip = "127.0.0.1";
+   const char* ip = argc < 5 ? "127.0.0.1" : argv[4];
+   // see util/Affinity.h, the topology can be overridden with L5RDMA_TOPOLOGY
+   const auto spread = argc < 6 ? Spread::None : l5::util::parseSpread(argv[5]);
+   const auto topology = Topology::fromEnvironment();
    const auto connection = [&] {
       if (isClient) {
          return ip + std::string(":") + std::to_string(port);
@@ -162,10 +174,12 @@ int main(int argc, char** argv) {
       }
    }();
 
-   if (not isClient) database = YcsbDatabase();
+   if (not isClient) database = YcsbDatabase::openSnapshot();
    if (not isClient) std::cout << "connection, MB, time, MB/s, user, system, total\n";
    if (not isClient) std::cout << "tcp, ";
-   doRun<MulticlientTCPTransportServer, MulticlientTCPTransportClient>(isClient, connection, numClientThreadsPerServer, numServerThreads);
+   doRun<MulticlientTCPTransportServer, MulticlientTCPTransportClient>(isClient, connection, numClientThreadsPerServer,
+                                                                       numServerThreads, topology, spread);
    if (not isClient) std::cout << "rdma, ";
-   doRun<MulticlientRDMATransportServer, MultiClientRDMATransportClient>(isClient, connection, numClientThreadsPerServer, numServerThreads);
+   doRun<MulticlientRDMATransportServer, MultiClientRDMATransportClient>(isClient, connection, numClientThreadsPerServer,
+                                                                         numServerThreads, topology, spread);
 }
@@ -0,0 +1,215 @@
+#include <include/DomainSocketsTransport.h>
+#include <include/TcpTransport.h>
+#include <include/SharedMemoryTransport.h>
+#include "include/RdmaTransport.h"
+#include <array>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "util/bench.h"
+#include "util/ycsb.h"
+#include "util/doNotOptimize.h"
+
+using namespace l5::transport;
+
+static constexpr uint16_t port = 1234;
+static std::string_view ip = "127.0.0.1";
+
+/// Each request is a YcsbRequest, followed by the new field value (Update, ReadModifyWrite) or the new tuple (Insert)
+/// Each response is a YcsbResponse, followed by the field (Read, ReadModifyWrite) or count tuples (Scan)
+struct YcsbResponse {
+    uint32_t count;
+    YcsbKey key;
+};
+
+/// Connection string of the server thread / client connection number i
+std::string connectionOf(std::string_view transport, bool isClient, size_t i) {
+    if (transport == "DS" || transport == "SHM") {
+        return "/tmp/ycsbSocket" + std::to_string(i);
+    }
+    const auto p = std::to_string(port + i);
+    return isClient ? std::string(ip) + ":" + p : p;
+}
+
+template<class Server>
+void serve(Server &server, YcsbDatabase &database, size_t operations, uint32_t maxScanLength) {
+    auto value = std::array<char, ycsb_field_length>{};
+    auto tuple = YcsbDataSet{};
+    auto scanned = std::vector<YcsbDataSet>(maxScanLength);
+
+    for (size_t i = 0; i < operations; ++i) {
+        auto request = YcsbRequest{};
+        server.read(request);
+        auto response = YcsbResponse{1, request.key};
+        switch (request.operation) {
+            case YcsbOperation::Read:
+                database.lookup(request.key, request.field, value.begin());
+                server.write(response);
+                server.write(value);
+                break;
+            case YcsbOperation::Update:
+                server.read(value);
+                database.update(request.key, request.field, value.data());
+                server.write(response);
+                break;
+            case YcsbOperation::ReadModifyWrite: {
+                server.read(value);
+                auto old = std::array<char, ycsb_field_length>{};
+                database.readModifyWrite(request.key, request.field, value.data(), old.begin());
+                server.write(response);
+                server.write(old);
+                break;
+            }
+            case YcsbOperation::Insert:
+                server.read(tuple);
+                response.key = database.insert(tuple);
+                server.write(response);
+                break;
+            case YcsbOperation::Scan: {
+                const auto length = std::min(request.scanLength, maxScanLength);
+                response.count = static_cast<uint32_t>(
+                        database.scan(request.key, length, reinterpret_cast<char *>(scanned.data())));
+                server.write(response);
+                server.write(reinterpret_cast<const uint8_t *>(scanned.data()), response.count * sizeof(YcsbDataSet));
+                break;
+            }
+        }
+    }
+}
+
+template<class Client>
+void issue(Client &client, const YcsbWorkload &workload, size_t operations, uint32_t seed) {
+    auto generator = YcsbRequestGenerator(workload, ycsb_tuple_count, seed);
+    auto randomString = RandomString{Random32(seed)};
+    auto value = std::array<char, ycsb_field_length>{};
+    auto tuple = YcsbDataSet(randomString);
+    auto scanned = std::vector<YcsbDataSet>(workload.maxScanLength);
+
+    for (size_t i = 0; i < operations; ++i) {
+        const auto request = generator.next();
+        client.write(request);
+        if (request.operation == YcsbOperation::Update || request.operation == YcsbOperation::ReadModifyWrite) {
+            randomString.fill(value);
+            client.write(value);
+        } else if (request.operation == YcsbOperation::Insert) {
+            client.write(tuple);
+        }
+
+        auto response = YcsbResponse{};
+        client.read(response);
+        switch (request.operation) {
+            case YcsbOperation::Read:
+            case YcsbOperation::ReadModifyWrite:
+                client.read(value);
+                DoNotOptimize(value);
+                break;
+            case YcsbOperation::Insert:
+                generator.inserted(response.key);
+                break;
+            case YcsbOperation::Scan:
+                client.read(reinterpret_cast<uint8_t *>(scanned.data()), response.count * sizeof(YcsbDataSet));
+                DoNotOptimize(scanned);
+                break;
+            case YcsbOperation::Update:
+                break;
+        }
+    }
+}
+
+/// Runs the workload on `threads` connections, each with its own server thread, all sharing one database
+template<class Server, class Client>
+void doRun(bool isClient, std::string_view transport, const YcsbWorkload &workload, size_t threads) {
+    const auto operationsPerThread = ycsb_tx_count / threads;
+
+    if (isClient) {
+        std::vector<std::thread> clientThreads;
+        for (size_t c = 0; c < threads; ++c) {
+            clientThreads.emplace_back([&, c] {
+                auto client = Client();
+                for (int i = 0;; ++i) {
+                    try {
+                        client.connect(connectionOf(transport, true, c));
+                        break;
+                    } catch (...) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                        if (i > 1000) throw;
+                    }
+                }
+                issue(client, workload, operationsPerThread, static_cast<uint32_t>(c + 1));
+            });
+        }
+        for (auto &t : clientThreads) t.join();
+    } else { // server
+        // every operation might be an insert
+        auto database = YcsbDatabase::openSnapshot(ycsbSnapshotPath, ycsb_tuple_count,
+                                                   ycsb_tuple_count + ycsb_tx_count);
+        std::vector<std::unique_ptr<Server>> servers;
+        for (size_t s = 0; s < threads; ++s) {
+            servers.push_back(std::make_unique<Server>(connectionOf(transport, false, s)));
+        }
+        for (auto &server : servers) {
+            server->accept();
+        }
+
+        bench(operationsPerThread * threads, [&] {
+            std::vector<std::thread> serverThreads;
+            for (auto &server : servers) {
+                serverThreads.emplace_back([&] {
+                    serve(*server, database, operationsPerThread, workload.maxScanLength);
+                });
+            }
+            for (auto &t : serverThreads) t.join();
+        });
+    }
+}
+
+/// A workload name (A - F), or custom proportions "read:update:insert:scan:readModifyWrite"
+YcsbWorkload parseWorkload(std::string_view name) {
+    if (name.size() == 1) {
+        return ycsbWorkload(name[0]);
+    }
+    auto workload = YcsbWorkload{0, 0, 0, 0, 0, false, 100};
+    auto stream = std::istringstream(std::string(name));
+    char colon;
+    stream >> workload.read >> colon >> workload.update >> colon >> workload.insert >> colon >> workload.scan >> colon
+           >> workload.readModifyWrite;
+    if (not stream) {
+        throw std::invalid_argument{"expected read:update:insert:scan:readModifyWrite"};
+    }
+    return workload;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0]
+                  << " <client / server> <[DS|SHM|TCP|RDMA]> <workload [A-F] or read:update:insert:scan:rmw>"
+                     " <threads = 4> <(IP, optional) 127.0.0.1>" << std::endl;
+        return -1;
+    }
+    const auto isClient = std::string_view(argv[1]) == "client";
+    const auto transport = std::string_view(argv[2]);
+    const auto workloadName = std::string_view(argv[3]);
+    const auto workload = parseWorkload(workloadName);
+    const auto threads = argc > 4 ? std::stoul(argv[4]) : 4ul;
+    if (argc > 5) ip = argv[5];
+
+    if (!isClient)
+        std::cout << "workload, threads, connection, transactions, time, msgps, user, system, total" << perfHeader()
+                  << "\n";
+    if (!isClient) std::cout << workloadName << ", " << threads << ", ";
+
+    if (transport == "DS") {
+        if (!isClient) std::cout << "domainSocket, ";
+        doRun<DomainSocketsTransportServer, DomainSocketsTransportClient>(isClient, transport, workload, threads);
+    } else if (transport == "SHM") {
+        if (!isClient) std::cout << "shared memory, ";
+        doRun<SharedMemoryTransportServer<>, SharedMemoryTransportClient<>>(isClient, transport, workload, threads);
+    } else if (transport == "TCP") {
+        if (!isClient) std::cout << "tcp, ";
+        doRun<TcpTransportServer, TcpTransportClient>(isClient, transport, workload, threads);
+    } else if (transport == "RDMA") {
+        if (!isClient) std::cout << "rdma, ";
+        doRun<RdmaTransportServer<>, RdmaTransportClient<>>(isClient, transport, workload, threads);
+    }
+}
@@ -3,12 +3,15 @@
 #include <include/SharedMemoryTransport.h>
 #include "include/RdmaTransport.h"
 #include <array>
+#include <cstring>
 #include <vector>
 #include <thread>
 #include "util/bench.h"
 #include "util/ycsb.h"
 #include "util/Random32.h"
 #include "util/doNotOptimize.h"
+#include "util/socket/tcp.h"
+#include "datastructures/RdmaHashIndex.h"
 
 using namespace l5::transport;
 
@@ -16,7 +19,7 @@ static constexpr uint16_t port = 1234;
 static std::string_view ip = "127.0.0.1";
 
 void doRunNoCommunication() {
-    const auto database = YcsbDatabase();
+    const auto database = YcsbDatabase::openSnapshot();
     auto rand = Random32();
     const auto lookupKeys = generateZipfLookupKeys(ycsb_tx_count * 10);
     std::array<char, ycsb_field_length> data{};
@@ -68,7 +71,7 @@ void doRun(bool isClient, std::string connection) {
         }
     } else { // server
         auto server = Server(connection);
-        const auto database = YcsbDatabase();
+        const auto database = YcsbDatabase::openSnapshot();
         server.accept();
         bench(ycsb_tx_count, [&] {
             for (size_t i = 0; i < ycsb_tx_count; ++i) {
@@ -83,9 +86,72 @@ void doRun(bool isClient, std::string connection) {
     }
 }
 
+/// Clients resolve lookups with one-sided RDMA READs against the server's RdmaHashIndex, the server CPU stays idle.
+/// So the client times its lookups, the keys are generated beforehand
+void doRunRdmaRead(bool isClient) {
+    using namespace l5::util;
+    using l5::datastructure::RdmaHashIndex;
+    using l5::datastructure::RdmaHashIndexClient;
+
+    if (isClient) {
+        auto sock = Socket::create();
+        for (int i = 0;; ++i) {
+            try {
+                tcp::connect(sock, std::string(ip), port);
+                break;
+            } catch (...) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                if (i > 1000) throw;
+            }
+        }
+        auto net = RDMANetworking(sock);
+        auto index = RdmaHashIndexClient(net, sock);
+
+        auto rand = Random32();
+        const auto lookupKeys = generateZipfLookupKeys(ycsb_tx_count);
+        auto tuple = YcsbDataSet{};
+        std::array<char, ycsb_field_length> response{};
+
+        std::cout << "rdma read, ";
+        bench(ycsb_tx_count, [&] {
+            for (const auto lookupKey: lookupKeys) {
+                const auto field = rand.next() % ycsb_field_count;
+                if (not index.get(lookupKey, reinterpret_cast<uint8_t *>(&tuple))) {
+                    throw std::runtime_error{"key not found"};
+                }
+                std::copy(tuple[field].begin(), tuple[field].end(), response.begin());
+                DoNotOptimize(response);
+            }
+        });
+        tcp::write(sock, "EOF", 4);
+    } else { // server
+        auto sock = Socket::create();
+        tcp::bind(sock, port);
+        tcp::listen(sock);
+        auto acced = tcp::accept(sock);
+        auto net = RDMANetworking(acced);
+
+        // index the tuples where they are, instead of copying the whole database into the index's heap
+        auto database = YcsbDatabase::openSnapshot();
+        const auto databaseMr = net.network.registerMr(database.data(), database.sizeInBytes(),
+                                                       {ibv::AccessFlag::REMOTE_READ});
+        auto index = RdmaHashIndex(net.network, ycsb_tuple_count, sizeof(YcsbDataSet), *databaseMr);
+        for (YcsbKey key = 0; key < database.size(); ++key) {
+            index.putExternal(key, key * sizeof(YcsbDataSet));
+        }
+        index.sendInfo(acced);
+
+        char eof[4];
+        tcp::read(acced, eof, sizeof(eof));
+        if (std::strcmp(eof, "EOF") != 0) {
+            throw std::runtime_error{"unexpected message from client"};
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     if (argc < 3) {
-        std::cout << "Usage: " << argv[0] << " <client / server> <[DS|SHM|TCP|RDMA]> <(IP, optional) 127.0.0.1>" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <client / server> <[DS|SHM|TCP|RDMA|RDMA_READ]> <(IP, optional) 127.0.0.1>" << std::endl;
         return -1;
     }
     const auto isClient = std::string_view(argv[1]) == "client";
@@ -97,7 +163,7 @@ int main(int argc, char **argv) {
     } else {
         connectionString = std::to_string(port);
     }
-    if (!isClient) std::cout << "connection, transactions, time, msgps, user, system, total\n";
+    if (!isClient) std::cout << "connection, transactions, time, msgps, user, system, total" << perfHeader() << "\n";
     if (!isClient) doRunNoCommunication();
 
     if (transportProtocol == "DS") {
@@ -112,5 +178,8 @@ int main(int argc, char **argv) {
     } else if (transportProtocol == "RDMA") {
         if (!isClient) std::cout << "rdma, ";
         doRun<RdmaTransportServer<>, RdmaTransportClient<>>(isClient, connectionString);
+    } else if (transportProtocol == "RDMA_READ") {
+        // the client prints this result
+        doRunRdmaRead(isClient);
     }
 }
@@ -26,7 +26,7 @@ int main(int argc, char **argv) {
         ip = argv[2];
     }
 
-    cout << "size, connection, messages, time, msgps, user, system, total\n";
+    cout << "size, connection, messages, time, msgps, user, system, total" << perfHeader() << "\n";
     for (const size_t size : {1u, 2u, 4u, 8u, 16u, 32u, 64u, 128u, 256u}) {
         if (isClient) {
             std::vector<uint8_t> testdata(size);